@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Tiny benchmark helpers: results are printed one JSON object per line, so they can be collected/compared across commits
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double secondsSince(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps the optimiser from throwing away results
+template<class T>
+inline void doNotOptimise(T const &value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+
+// Seconds per call of `fn()`, as the median of several timed runs - much steadier across runs (and commits) than a single long one
+template<class Fn>
+double medianSecondsPerCall(Fn &&fn, size_t calls, size_t runs=9) {
+	std::vector<double> perCall(runs);
+	fn(); // warm-up
+	for (auto &seconds : perCall) {
+		auto start = Clock::now();
+		for (size_t i = 0; i < calls; ++i) fn();
+		seconds = secondsSince(start)/double(calls);
+	}
+	std::sort(perCall.begin(), perCall.end());
+	return perCall[runs/2];
+}
+
+struct Result {
+	std::string name;
+	std::vector<std::pair<std::string, std::string>> fields;
+
+	Result(const std::string &name) : name(name) {}
+
+	Result & add(const std::string &key, const std::string &value) {
+		std::string quoted = "\"";
+		for (auto c : value) {
+			if (c == '"' || c == '\\') quoted += '\\';
+			quoted += c;
+		}
+		fields.emplace_back(key, quoted + "\"");
+		return *this;
+	}
+	Result & add(const std::string &key, const char *value) {
+		return add(key, std::string(value));
+	}
+	Result & add(const std::string &key, size_t value) {
+		fields.emplace_back(key, std::to_string(value));
+		return *this;
+	}
+	Result & add(const std::string &key, double value) {
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+		fields.emplace_back(key, buffer);
+		return *this;
+	}
+
+	~Result() {
+		std::printf("{\"benchmark\":\"%s\"", name.c_str());
+		for (auto &pair : fields) {
+			std::printf(",\"%s\":%s", pair.first.c_str(), pair.second.c_str());
+		}
+		std::printf("}\n");
+		std::fflush(stdout);
+	}
+};
+
+} // namespace
@@ -0,0 +1,32 @@
+#pragma once
+
+// Replaces the global `operator new`/`operator delete` to count heap allocations - include it in exactly one translation unit
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace bench {
+	inline std::atomic<size_t> allocationCount{0};
+	inline size_t allocations() {
+		return allocationCount.load(std::memory_order_relaxed);
+	}
+}
+
+// Not inlined, so GCC doesn't pair our `free()` with the `operator new` it sees at the call site (a false -Wmismatched-new-delete)
+#if defined(__GNUC__)
+#	define BENCH_ALLOCATOR __attribute__((noinline))
+#else
+#	define BENCH_ALLOCATOR
+#endif
+
+BENCH_ALLOCATOR void * operator new(size_t bytes) {
+	bench::allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void *pointer = std::malloc(bytes ? bytes : 1)) return pointer;
+	throw std::bad_alloc();
+}
+BENCH_ALLOCATOR void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+BENCH_ALLOCATOR void operator delete(void *pointer, size_t) noexcept {
+	std::free(pointer);
+}
@@ -0,0 +1,55 @@
+// Receive dispatch: `WebviewGui::receive` (a `std::function`, after a shared decode) against `BasicWebviewGui` (decode compiled for the handler, with it inlined), for small messages where dispatch matters most
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/basic-webview-gui.h"
+#include "./bench.h"
+
+#include <cstdint>
+#include <vector>
+
+struct SumHandler {
+	uint64_t *sum;
+	void operator()(const unsigned char *bytes, size_t length) {
+		for (size_t i = 0; i < length; ++i) *sum += bytes[i];
+	}
+};
+
+template<size_t messageSize>
+void run(const WebviewGui::ResourceGetter &getter) {
+	webview_gui::loopback::Page *page = nullptr;
+	webview_gui::loopback::script.load = [&](webview_gui::loopback::Page &p){
+		page = &p;
+	};
+	uint64_t sum = 0;
+
+	auto erased = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", getter);
+	auto *erasedPage = page;
+	erased->receive = SumHandler{&sum};
+
+	auto variable = webview_gui::BasicWebviewGui<SumHandler>::create(SumHandler{&sum}, WebviewGui::X11EMBED, "/index.html", getter);
+	auto *variablePage = page;
+
+	auto fixed = webview_gui::BasicWebviewGui<SumHandler, webview_gui::FixedFrames<messageSize>>::create(SumHandler{&sum}, WebviewGui::X11EMBED, "/index.html", getter);
+	auto *fixedPage = page;
+
+	std::vector<unsigned char> message(messageSize, 1);
+	for (auto &pair : {std::make_pair("std::function", erasedPage), std::make_pair("BasicWebviewGui", variablePage), std::make_pair("BasicWebviewGui+FixedFrames", fixedPage)}) {
+		auto *target = pair.second;
+		double seconds = bench::medianSecondsPerCall([&](){
+			target->post(message.data(), message.size());
+		}, 1000000/messageSize + 50000);
+		bench::doNotOptimise(sum);
+		bench::Result("dispatch").add("kind", pair.first).add("bytes", messageSize)
+			.add("messagesPerSecond", 1/seconds)
+			.add("nsPerMessage", seconds*1e9);
+	}
+}
+
+int main() {
+	auto getter = [](const char *, WebviewGui::Resource &){
+		return true;
+	};
+	run<1>(getter);
+	run<16>(getter);
+	run<256>(getter);
+}
@@ -0,0 +1,84 @@
+// The JS half of a GUI, run in CHOC's embedded QuickJS: script start-up, and message handling through the injected runtime (base64, framing, dispatch) with a page which echoes everything
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_HEADLESS_JS
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+
+#include <algorithm>
+
+static const char *pageHtml = R"HTML(<!DOCTYPE html>
+<html>
+	<body>
+		<script src="echo.js"></script>
+	</body>
+</html>)HTML";
+static const char *echoJs = R"JS(
+	window.addEventListener('message', e=>window.parent.postMessage(e.data, '*'));
+	let echoChannel = webviewGui.channel('echo');
+	echoChannel.addEventListener('message', e=>echoChannel.send(e.data));
+)JS";
+
+int main() {
+	auto getter = [](const char *path, WebviewGui::Resource &resource){
+		std::string content = (std::string(path) == "/index.html") ? pageHtml : (std::string(path) == "/echo.js") ? echoJs : "";
+		if (content.empty()) return false;
+		resource.bytes.assign(content.begin(), content.end());
+		return true;
+	};
+
+	// Start-up: a fresh engine, the shim and runtime, and the page's scripts
+	std::vector<double> startups;
+	for (int i = 0; i < 20; ++i) {
+		auto start = bench::Clock::now();
+		auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", getter);
+		startups.push_back(bench::secondsSince(start));
+	}
+	std::sort(startups.begin(), startups.end());
+	bench::Result("headless-js-startup").add("p50ms", startups[startups.size()/2]*1e3).add("maxMs", startups.back()*1e3);
+
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", getter);
+	size_t received = 0;
+	gui->receive = [&](const unsigned char *, size_t length){
+		received += length;
+	};
+	gui->receiveText = [&](const char *, size_t length){
+		received += length;
+	};
+	uint32_t echoChannel = gui->channel("echo", [&](const unsigned char *, size_t length){
+		received += length;
+	});
+
+	for (size_t messageSize : {16, 256, 4096, 65536}) {
+		std::vector<unsigned char> message(messageSize);
+		for (size_t i = 0; i < messageSize; ++i) message[i] = (unsigned char)(i*31);
+		for (uint32_t channel : {uint32_t(0), echoChannel}) {
+			size_t count = std::max<size_t>(20, (size_t(4) << 20)/messageSize/4);
+			std::vector<double> latencies;
+			latencies.reserve(count);
+			received = 0;
+			auto start = bench::Clock::now();
+			for (size_t i = 0; i < count; ++i) {
+				auto sendStart = bench::Clock::now();
+				gui->send(channel, message.data(), message.size());
+				latencies.push_back(bench::secondsSince(sendStart));
+			}
+			double seconds = bench::secondsSince(start);
+			std::sort(latencies.begin(), latencies.end());
+			bench::Result("headless-js-round-trip").add("bytes", messageSize).add("channel", channel ? "named" : "plain").add("messages", count)
+				.add("messagesPerSecond", count/seconds)
+				.add("mbPerSecond", received/seconds/1e6)
+				.add("p50us", latencies[count/2]*1e6)
+				.add("p99us", latencies[count*99/100]*1e6);
+		}
+	}
+
+	std::string json = "{\"values\":[";
+	for (int i = 0; i < 200; ++i) json += (i ? "," : "") + std::to_string(i*0.37);
+	json += "]}";
+	size_t count = 2000;
+	received = 0;
+	auto start = bench::Clock::now();
+	for (size_t i = 0; i < count; ++i) gui->sendText(json);
+	double seconds = bench::secondsSince(start);
+	bench::Result("headless-js-text").add("bytes", json.size()).add("messagesPerSecond", count/seconds).add("mbPerSecond", received/seconds/1e6);
+}
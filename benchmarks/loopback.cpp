@@ -0,0 +1,103 @@
+// Message round-trips through the loopback backend: everything above the platform layer (framing, base64, dispatch), without a display
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+#include "./count-allocations.h"
+
+#include <algorithm>
+
+int main() {
+	// The default loopback script echoes every message
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", [](const char * /*path*/, WebviewGui::Resource &resource){
+		resource.bytes.assign(1000, ' ');
+		return true;
+	});
+
+	size_t received = 0;
+	gui->receive = [&](const unsigned char * /*bytes*/, size_t length){
+		received += length;
+	};
+
+	for (size_t messageSize : {16, 256, 4096, 65536, 1048576}) {
+		std::vector<unsigned char> message(messageSize);
+		for (size_t i = 0; i < messageSize; ++i) message[i] = (unsigned char)(i*31);
+
+		size_t count = std::max<size_t>(20, (size_t(64) << 20)/messageSize/8);
+		std::vector<double> latencies;
+		latencies.reserve(count);
+		received = 0;
+		auto allocationsStart = bench::allocations();
+		auto start = bench::Clock::now();
+		for (size_t i = 0; i < count; ++i) {
+			auto sendStart = bench::Clock::now();
+			gui->send(message.data(), message.size());
+			latencies.push_back(bench::secondsSince(sendStart));
+		}
+		double seconds = bench::secondsSince(start);
+		// Including the (simulated) page's echo, but not counting any scratch-arena growth in the first message
+		double allocationsPerMessage = double(bench::allocations() - allocationsStart)/count;
+		std::sort(latencies.begin(), latencies.end());
+
+		bench::Result("loopback-round-trip").add("bytes", messageSize).add("messages", count)
+			.add("messagesPerSecond", count/seconds)
+			.add("mbPerSecond", received/seconds/1e6)
+			.add("p50us", latencies[count/2]*1e6)
+			.add("p99us", latencies[count*99/100]*1e6)
+			.add("allocationsPerMessage", allocationsPerMessage);
+	}
+
+	// JSON as text (escaped into a JS string literal) versus the same bytes through base64
+	std::string json = "{\"values\":[";
+	for (int i = 0; i < 200; ++i) json += (i ? "," : "") + std::to_string(i*0.37);
+	json += "],\"name\":\"caf\u00e9 \\\"quoted\\\"\"}";
+	gui->receiveText = [&](const char * /*text*/, size_t length){
+		received += length;
+	};
+	for (bool text : {false, true}) {
+		size_t count = 20000;
+		received = 0;
+		auto start = bench::Clock::now();
+		for (size_t i = 0; i < count; ++i) {
+			if (text) {
+				gui->sendText(json);
+			} else {
+				gui->send((const unsigned char *)json.data(), json.size());
+			}
+		}
+		double seconds = bench::secondsSince(start);
+		bench::Result("loopback-json").add("kind", text ? "text" : "base64").add("bytes", json.size())
+			.add("messagesPerSecond", count/seconds)
+			.add("mbPerSecond", received/seconds/1e6);
+	}
+
+	// Page-echoed latency probes, as recorded in the metrics histogram
+	for (size_t i = 0; i < 10000; ++i) gui->probeLatency();
+	auto metrics = gui->metrics.snapshot();
+	bench::Result("loopback-probe").add("probes", size_t(metrics.roundTrip.total))
+		.add("p50us", metrics.roundTrip.percentileSeconds(0.5)*1e6)
+		.add("p99us", metrics.roundTrip.percentileSeconds(0.99)*1e6)
+		.add("encodeSeconds", metrics.encodeSeconds)
+		.add("decodeSeconds", metrics.decodeSeconds);
+
+	// Dispatch by channel ID shouldn't depend on how many other channels there are
+	for (size_t channelCount : {1, 16, 256}) {
+		std::vector<uint32_t> ids;
+		for (size_t c = 0; c < channelCount; ++c) {
+			ids.push_back(gui->channel("bench-" + std::to_string(channelCount) + "-" + std::to_string(c), [&](const unsigned char * /*bytes*/, size_t length){
+				received += length;
+			}));
+		}
+		std::vector<unsigned char> message(16);
+		size_t count = 200000;
+		received = 0;
+		auto start = bench::Clock::now();
+		for (size_t i = 0; i < count; ++i) {
+			gui->send(ids[i%channelCount], message.data(), message.size());
+		}
+		double seconds = bench::secondsSince(start);
+		bench::Result("loopback-channels").add("channels", channelCount).add("messages", count)
+			.add("messagesPerSecond", count/seconds)
+			.add("receivedBytes", received);
+	}
+}
@@ -0,0 +1,161 @@
+// Microbenchmarks of the building blocks: base64, media-type guessing, the resource getters (including the directory reader) and `ClapWebviewGui`'s proxy dispatch under contention
+// Each result is the median of several runs, so they can be compared across commits
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/webview-gui.h"
+#include "webview-gui/router.h"
+#include "./bench.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#if defined(__has_include) && __has_include("clap/clap.h")
+#	include "webview-gui/clap-webview-gui.h"
+#	define BENCH_CLAP 1
+#else
+#	define BENCH_CLAP 0
+#endif
+
+using namespace webview_gui;
+
+static void base64() {
+	for (size_t bytes : {16, 1024, 65536}) {
+		std::vector<unsigned char> binary(bytes), decoded;
+		for (size_t i = 0; i < bytes; ++i) binary[i] = (unsigned char)(i*31 + 7);
+		std::string encoded;
+		size_t calls = std::max<size_t>(10, (size_t(4) << 20)/bytes);
+		double encodeSeconds = bench::medianSecondsPerCall([&](){
+			encoded.clear();
+			helpers::encodeBase64(binary.data(), binary.size(), encoded);
+			bench::doNotOptimise(encoded.data());
+		}, calls);
+		double decodeSeconds = bench::medianSecondsPerCall([&](){
+			decoded.clear();
+			helpers::decodeBase64(encoded.c_str(), decoded);
+			bench::doNotOptimise(decoded.data());
+		}, calls);
+		bench::Result("base64-encode").add("bytes", bytes).add("nsPerCall", encodeSeconds*1e9).add("mbPerSecond", bytes/encodeSeconds/1e6);
+		bench::Result("base64-decode").add("bytes", bytes).add("nsPerCall", decodeSeconds*1e9).add("mbPerSecond", bytes/decodeSeconds/1e6);
+	}
+}
+
+static void mediaTypes() {
+	for (const char *path : {"/index.html", "/scripts/main.js", "/style.css", "/images/knob.png", "/fonts/ui.woff2", "/data.unknownext", "/no-extension"}) {
+		double seconds = bench::medianSecondsPerCall([&](){
+			bench::doNotOptimise(helpers::guessMediaType(path));
+		}, 100000);
+		bench::Result("guess-media-type").add("path", path).add("nsPerCall", seconds*1e9);
+	}
+}
+
+static void resourceGetters() {
+	auto dir = std::filesystem::temp_directory_path()/"webview-gui-bench";
+	std::filesystem::create_directories(dir);
+	std::vector<std::pair<std::string, size_t>> files{{"/small.js", 1024}, {"/medium.css", 65536}, {"/large.bin", 1 << 20}};
+	for (auto &file : files) {
+		std::ofstream stream{dir.string() + file.first, std::ios::binary};
+		std::string content(file.second, 'x');
+		stream.write(content.data(), content.size());
+	}
+
+	// The loopback backend's `create(..., baseDir)` uses the same directory reader as the native backends
+	loopback::Page *page = nullptr;
+	loopback::script.load = [&](loopback::Page &p){
+		page = &p;
+	};
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/small.js", dir.string());
+	auto routerGetter = Router{}.route("/api/{name}", [](const Router::Request &request, WebviewGui::Resource &resource){
+		resource.bytes.assign(request.param("name").begin(), request.param("name").end());
+		return true;
+	}).directory(dir.string()).getter();
+
+	for (auto &file : files) {
+		size_t calls = std::max<size_t>(20, (size_t(16) << 20)/file.second);
+		WebviewGui::Resource resource;
+		double directorySeconds = bench::medianSecondsPerCall([&](){
+			resource.bytes.clear();
+			bench::doNotOptimise(page->fetch(file.first.c_str(), resource));
+		}, calls);
+		double routerSeconds = bench::medianSecondsPerCall([&](){
+			resource.bytes.clear();
+			bench::doNotOptimise(routerGetter(file.first.c_str(), resource));
+		}, calls);
+		bench::Result("resource-getter").add("getter", "directory").add("bytes", file.second).add("usPerCall", directorySeconds*1e6).add("mbPerSecond", file.second/directorySeconds/1e6);
+		bench::Result("resource-getter").add("getter", "router-directory").add("bytes", file.second).add("usPerCall", routerSeconds*1e6).add("mbPerSecond", file.second/routerSeconds/1e6);
+	}
+	WebviewGui::Resource resource;
+	bench::Result("resource-getter").add("getter", "router-route").add("usPerCall", bench::medianSecondsPerCall([&](){
+		resource.bytes.clear();
+		bench::doNotOptimise(routerGetter("/api/presets", resource));
+	}, 100000)*1e6);
+	bench::Result("resource-getter").add("getter", "directory-not-found").add("usPerCall", bench::medianSecondsPerCall([&](){
+		bench::doNotOptimise(page->fetch("/missing.txt", resource));
+	}, 10000)*1e6);
+
+	gui = nullptr;
+	loopback::script.load = nullptr;
+	std::filesystem::remove_all(dir);
+}
+
+#if BENCH_CLAP
+// Every host call into a `ClapWebviewGui` goes through a static proxy, which finds the instance from the `plugin`/`host` pointer
+static void clapProxies() {
+	constexpr size_t instanceCount = 64, callsPerThread = 1000000;
+	std::vector<clap_plugin> plugins(instanceCount);
+	std::vector<clap_host> hosts(instanceCount);
+	std::vector<std::unique_ptr<ClapWebviewGui>> guis;
+	for (size_t i = 0; i < instanceCount; ++i) {
+		plugins[i] = {};
+		hosts[i] = {};
+		guis.emplace_back(new ClapWebviewGui(&plugins[i], &hosts[i]));
+	}
+
+	size_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+	for (size_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+		for (bool hostSend : {false, true}) {
+			std::vector<double> nsPerCall(threadCount);
+			std::vector<std::thread> threads;
+			std::atomic<size_t> ready{0};
+			std::atomic<bool> go{false};
+			for (size_t t = 0; t < threadCount; ++t) {
+				threads.emplace_back([&, t](){
+					++ready;
+					while (!go) std::this_thread::yield();
+					unsigned char message[16] = {};
+					uint32_t w, h;
+					auto start = bench::Clock::now();
+					for (size_t i = 0; i < callsPerThread; ++i) {
+						size_t index = (i + t*7)%instanceCount;
+						if (hostSend) {
+							// No native webview and no host extension, so this is just the dispatch
+							bench::doNotOptimise(guis[index]->extHostWebview->send(&hosts[index], message, sizeof(message)));
+						} else {
+							bench::doNotOptimise(guis[index]->extPluginGui->get_size(&plugins[index], &w, &h));
+						}
+					}
+					nsPerCall[t] = bench::secondsSince(start)*1e9/double(callsPerThread);
+				});
+			}
+			while (ready < threadCount) std::this_thread::yield();
+			go = true;
+			for (auto &thread : threads) thread.join();
+			std::sort(nsPerCall.begin(), nsPerCall.end());
+			bench::Result("clap-proxy").add("call", hostSend ? "host_webview.send" : "plugin_gui.get_size").add("instances", instanceCount).add("threads", threadCount)
+				.add("nsPerCall", nsPerCall[threadCount/2]);
+		}
+	}
+}
+#endif
+
+int main() {
+	base64();
+	mediaTypes();
+	resourceGetters();
+#if BENCH_CLAP
+	clapProxies();
+#else
+	bench::Result("clap-proxy").add("skipped", "clap/clap.h not found");
+#endif
+}
@@ -0,0 +1,79 @@
+// Compares the lock-free `helpers::AtomicPointerMap` (used by `ClapWebviewGui` to find itself from `plugin`/`host` pointers) against the previous `std::shared_mutex` + `std::unordered_map` lookup, with many threads hammering it at once
+#include "webview-gui/helpers.h"
+#include "./bench.h"
+
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+struct Instance {
+	int counter = 0;
+};
+// Stand-in for a `clap_plugin`/`clap_host` struct, since we only use their addresses
+struct Key {
+	char bytes[64];
+};
+
+// What `ClapWebviewGui::getSelf()` used to do
+struct SharedMutexMap {
+	std::unordered_map<size_t, Instance *> map;
+	std::shared_mutex mutex;
+
+	Instance * get(const void *key) {
+		std::shared_lock guard{mutex};
+		return map[(size_t)key];
+	}
+	void set(const void *key, Instance *value) {
+		std::unique_lock guard{mutex};
+		map.insert_or_assign((size_t)key, value);
+	}
+};
+
+template<class Map>
+double nsPerLookup(Map &map, std::vector<Key> &keys, size_t threadCount, size_t lookupsPerThread) {
+	std::atomic<size_t> ready{0};
+	std::atomic<bool> go{false};
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < threadCount; ++t) {
+		threads.emplace_back([&, t](){
+			++ready;
+			while (!go) {}
+			size_t index = t;
+			for (size_t i = 0; i < lookupsPerThread; ++i) {
+				auto *instance = map.get(&keys[index]);
+				bench::doNotOptimise(instance);
+				if (++index >= keys.size()) index = 0;
+			}
+		});
+	}
+	while (ready < threadCount) {}
+	auto start = bench::Clock::now();
+	go = true;
+	for (auto &thread : threads) thread.join();
+	return bench::secondsSince(start)*1e9/double(lookupsPerThread);
+}
+
+int main() {
+	constexpr size_t lookupsPerThread = 2000000;
+	size_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+	for (size_t instanceCount : {2, 64}) {
+		std::vector<Key> keys(instanceCount);
+		std::vector<Instance> instances(instanceCount);
+
+		SharedMutexMap sharedMutexMap;
+		webview_gui::helpers::AtomicPointerMap<Instance> atomicMap;
+		for (size_t i = 0; i < instanceCount; ++i) {
+			sharedMutexMap.set(&keys[i], &instances[i]);
+			atomicMap.set(&keys[i], &instances[i]);
+		}
+
+		for (size_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+			bench::Result("pointer-lookup").add("impl", "shared_mutex").add("instances", instanceCount).add("threads", threadCount)
+				.add("nsPerLookup", nsPerLookup(sharedMutexMap, keys, threadCount, lookupsPerThread));
+			bench::Result("pointer-lookup").add("impl", "atomic").add("instances", instanceCount).add("threads", threadCount)
+				.add("nsPerLookup", nsPerLookup(atomicMap, keys, threadCount, lookupsPerThread));
+		}
+	}
+}
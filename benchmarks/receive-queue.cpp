@@ -0,0 +1,90 @@
+// GUI->DSP messages: an audio-rate consumer draining a per-block budget while the UI thread receives messages from the page, with `ReceiveQueue` against a mutex-protected queue
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+
+#include <atomic>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+int main() {
+	webview_gui::loopback::Page *page = nullptr;
+	webview_gui::loopback::script.load = [&](webview_gui::loopback::Page &p){
+		page = &p;
+	};
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", [](const char *, WebviewGui::Resource &){
+		return true;
+	});
+
+	static constexpr size_t budget = 64; // messages per block
+	static constexpr auto blockInterval = std::chrono::microseconds(1333); // 64 samples at 48kHz
+
+	for (bool lockFree : {true, false}) {
+		for (size_t messageBytes : {16, 256, 4096}) {
+			std::mutex mutex;
+			std::deque<std::vector<unsigned char>> locked;
+			if (lockFree) {
+				gui->receive = nullptr;
+				gui->receiveQueue = std::make_shared<webview_gui::ReceiveQueue>(1 << 20);
+			} else {
+				// What plugins tend to write by hand
+				gui->receiveQueue = nullptr;
+				gui->receive = [&](const unsigned char *bytes, size_t length){
+					std::lock_guard<std::mutex> guard{mutex};
+					locked.emplace_back(bytes, bytes + length);
+				};
+			}
+
+			std::atomic<bool> running{true};
+			std::vector<double> drainSeconds;
+			drainSeconds.reserve(1 << 16);
+			size_t consumed = 0;
+			std::thread audio([&](){
+				auto next = bench::Clock::now();
+				while (running.load(std::memory_order_relaxed) && drainSeconds.size() < drainSeconds.capacity()) {
+					auto start = bench::Clock::now();
+					size_t sum = 0;
+					if (lockFree) {
+						consumed += gui->receiveQueue->drain([&](uint32_t, const unsigned char *bytes, size_t length){
+							sum += bytes[length - 1];
+						}, budget);
+					} else {
+						std::lock_guard<std::mutex> guard{mutex};
+						for (size_t i = 0; i < budget && !locked.empty(); ++i) {
+							sum += locked.front().back();
+							locked.pop_front();
+							++consumed;
+						}
+					}
+					bench::doNotOptimise(sum);
+					drainSeconds.push_back(bench::secondsSince(start));
+					next += blockInterval;
+					std::this_thread::sleep_until(next);
+				}
+			});
+
+			std::vector<unsigned char> message(messageBytes, 1);
+			size_t posted = 0;
+			auto start = bench::Clock::now();
+			while (bench::secondsSince(start) < 0.5) {
+				for (int i = 0; i < 16; ++i) page->post(message.data(), message.size());
+				posted += 16;
+				std::this_thread::yield();
+			}
+			running = false;
+			audio.join();
+
+			std::sort(drainSeconds.begin(), drainSeconds.end());
+			bench::Result("receive-queue").add("kind", lockFree ? "lock-free" : "mutex").add("bytes", messageBytes)
+				.add("posted", posted)
+				.add("consumed", consumed)
+				.add("dropped", lockFree ? size_t(gui->receiveQueue->droppedCount()) : size_t(0))
+				.add("drainP50us", drainSeconds[drainSeconds.size()/2]*1e6)
+				.add("drainP99us", drainSeconds[drainSeconds.size()*99/100]*1e6)
+				.add("drainMaxUs", drainSeconds.back()*1e6);
+		}
+	}
+}
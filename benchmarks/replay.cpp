@@ -0,0 +1,61 @@
+// Replays a recorded session (from `WebviewGui::recorder`) through the loopback backend, as fast as possible
+//     webview-gui-bench-replay [recording.bin]
+// Without an argument, it records a synthetic session first (bursts of meter updates with occasional larger state messages)
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+
+#include <cstdio>
+
+int main(int argc, char **argv) {
+	std::string path;
+	if (argc > 1) {
+		path = argv[1];
+	} else {
+		path = "webview-gui-bench-replay.bin";
+		auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", [](const char *, WebviewGui::Resource &){
+			return true;
+		});
+		gui->recorder = std::make_shared<webview_gui::Recorder>(path);
+		gui->receive = [](const unsigned char *, size_t){};
+		auto meters = gui->channel("meters", [](const unsigned char *, size_t){});
+		std::vector<unsigned char> meterMessage(64), stateMessage(16384);
+		for (size_t i = 0; i < 20000; ++i) {
+			gui->send(meters, meterMessage.data(), meterMessage.size());
+			if (i%100 == 0) gui->send(stateMessage.data(), stateMessage.size());
+		}
+	}
+
+	webview_gui::Replayer replayer;
+	if (!replayer.load(path)) {
+		std::fprintf(stderr, "couldn't read recording: %s\n", path.c_str());
+		return 1;
+	}
+
+	// The recording already has the page's side (e.g. the echoes from recording through the loopback backend), which is replayed as received messages - so the replaying page doesn't echo, or everything would be received twice
+	webview_gui::loopback::script.message = {};
+	webview_gui::loopback::script.channelMessage = {};
+	webview_gui::loopback::script.textMessage = {};
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", [](const char *, WebviewGui::Resource &){
+		return true;
+	});
+	gui->receive = [](const unsigned char *, size_t){};
+	// Handlers for any channels in the recording
+	for (auto &record : replayer.records) {
+		if (record.type == webview_gui::Recorder::Type::CHANNEL) {
+			gui->channel(std::string(record.payload.begin(), record.payload.end()), [](const unsigned char *, size_t){});
+		}
+	}
+
+	auto start = bench::Clock::now();
+	replayer.replay(*gui, 0);
+	double seconds = bench::secondsSince(start);
+
+	auto metrics = gui->metrics.snapshot();
+	bench::Result("replay").add("recording", path).add("records", replayer.records.size())
+		.add("recordedSeconds", replayer.records.empty() ? 0.0 : replayer.records.back().seconds)
+		.add("replaySeconds", seconds)
+		.add("messagesPerSecond", (metrics.messagesSent + metrics.messagesReceived)/seconds)
+		.add("mbPerSecond", (metrics.bytesSent + metrics.bytesReceived)/seconds/1e6);
+}
@@ -0,0 +1,50 @@
+// Resource routing: the trie-based `Router` against the usual (allocation-free) chain of prefix comparisons in a single getter
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/router.h"
+#include "./bench.h"
+
+#include <cstring>
+
+int main() {
+	for (size_t routeCount : {8, 64, 512}) {
+		std::vector<std::string> prefixes, paths;
+		webview_gui::Router router;
+		for (size_t i = 0; i < routeCount; ++i) {
+			auto prefix = "/section" + std::to_string(i) + "/";
+			prefixes.push_back(prefix);
+			router.route(prefix + "{id}/thumbnail.png", [](const webview_gui::Router::Request &request, WebviewGui::Resource & /*resource*/){
+				bench::doNotOptimise(request.param("id").size());
+				return true;
+			});
+			paths.push_back(prefix + std::to_string(i*7) + "/thumbnail.png?size=64");
+		}
+		auto trieGetter = router.getter();
+		WebviewGui::ResourceGetter chainGetter = [&](const char *path, WebviewGui::Resource & /*resource*/){
+			for (auto &prefix : prefixes) {
+				if (!std::strncmp(path, prefix.c_str(), prefix.size())) {
+					// The `{id}` parameter, without allocating
+					auto *id = path + prefix.size();
+					auto *end = std::strchr(id, '/');
+					bench::doNotOptimise(end ? size_t(end - id) : std::strlen(id));
+					return true;
+				}
+			}
+			return false;
+		};
+
+		size_t count = 1000000;
+		WebviewGui::Resource resource;
+		for (auto &pair : {std::make_pair("trie", &trieGetter), std::make_pair("chain", &chainGetter)}) {
+			auto &getter = *pair.second;
+			auto start = bench::Clock::now();
+			for (size_t i = 0; i < count; ++i) {
+				bench::doNotOptimise(getter(paths[(i*7919)%routeCount].c_str(), resource));
+			}
+			double seconds = bench::secondsSince(start);
+			bench::Result("router").add("kind", pair.first).add("routes", routeCount)
+				.add("lookupsPerSecond", count/seconds)
+				.add("nsPerLookup", seconds/count*1e9);
+		}
+	}
+}
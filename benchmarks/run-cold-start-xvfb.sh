@@ -0,0 +1,19 @@
+#!/bin/sh
+# Cold versus second-launch open time through WebKitGTK, under Xvfb: every launch is a new process, sharing one set of XDG cache/data homes (which is where WebKit's default store lives on Linux) which start out empty
+# Usage: run-cold-start-xvfb.sh [path/to/webview-gui-bench-webkitgtk-cold-start] [launches] > results.jsonl
+set -e
+
+BENCH="${1:-$(dirname "$0")/../build/benchmarks/webview-gui-bench-webkitgtk-cold-start}"
+LAUNCHES="${2:-5}"
+
+DATA="$(mktemp -d)"
+trap 'rm -rf "$DATA"' EXIT
+export XDG_CACHE_HOME="$DATA/cache"
+export XDG_DATA_HOME="$DATA/data"
+
+LAUNCH=0
+while [ "$LAUNCH" -lt "$LAUNCHES" ]; do
+	if [ "$LAUNCH" -eq 0 ]; then LABEL=cold; else LABEL=warm; fi
+	"$(dirname "$0")/run-webkitgtk-xvfb.sh" "$BENCH" "$LABEL"
+	LAUNCH=$((LAUNCH + 1))
+done
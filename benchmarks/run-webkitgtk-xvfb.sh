@@ -0,0 +1,15 @@
+#!/bin/sh
+# Runs a benchmark (by default the WebKitGTK round-trip one) headless, under Xvfb with software rendering
+# Usage: run-webkitgtk-xvfb.sh [path/to/webview-gui-bench-webkitgtk-round-trip [args...]] > results.jsonl
+set -e
+
+BENCH="${1:-$(dirname "$0")/../build/benchmarks/webview-gui-bench-webkitgtk-round-trip}"
+[ $# -gt 0 ] && shift
+
+export LIBGL_ALWAYS_SOFTWARE=1
+export WEBKIT_DISABLE_COMPOSITING_MODE=1
+export WEBKIT_DISABLE_DMABUF_RENDERER=1
+export GDK_BACKEND=x11
+export NO_AT_BRIDGE=1
+
+exec xvfb-run -a -s "-screen 0 1280x1024x24" "$BENCH" "$@"
@@ -0,0 +1,55 @@
+// Telemetry triple buffer: an audio-rate producer publishing while a display-rate consumer pulls the latest frame (through the loopback backend's resource path)
+#define WEBVIEW_GUI_HEADER_ONLY
+#define WEBVIEW_GUI_LOOPBACK
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+
+#include <atomic>
+#include <algorithm>
+#include <thread>
+
+int main() {
+	webview_gui::loopback::Page *page = nullptr;
+	webview_gui::loopback::script.load = [&](webview_gui::loopback::Page &p){
+		page = &p;
+	};
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", [](const char *, WebviewGui::Resource &){
+		return true;
+	});
+
+	for (size_t frameBytes : {64, 4096, 65536}) {
+		auto telemetry = std::make_shared<webview_gui::Telemetry>(frameBytes);
+		gui->serveTelemetry("bench", telemetry);
+
+		std::atomic<bool> running{true};
+		std::vector<double> publishSeconds;
+		publishSeconds.reserve(1 << 20);
+		std::thread producer([&](){
+			std::vector<unsigned char> frame(frameBytes);
+			while (running.load(std::memory_order_relaxed) && publishSeconds.size() < publishSeconds.capacity()) {
+				auto start = bench::Clock::now();
+				telemetry->publish(frame.data(), frame.size());
+				publishSeconds.push_back(bench::secondsSince(start));
+				frame[0]++;
+			}
+		});
+
+		size_t fetches = 0;
+		WebviewGui::Resource resource;
+		auto start = bench::Clock::now();
+		while (bench::secondsSince(start) < 0.5) {
+			page->fetch("/_webview-gui/telemetry/bench?1", resource);
+			++fetches;
+		}
+		running = false;
+		producer.join();
+		double seconds = bench::secondsSince(start);
+
+		std::sort(publishSeconds.begin(), publishSeconds.end());
+		bench::Result("telemetry").add("frameBytes", frameBytes)
+			.add("published", publishSeconds.size())
+			.add("fetchesPerSecond", fetches/seconds)
+			.add("publishP50ns", publishSeconds[publishSeconds.size()/2]*1e9)
+			.add("publishP99ns", publishSeconds[publishSeconds.size()*99/100]*1e9);
+	}
+}
@@ -0,0 +1,68 @@
+// The C++ half of `wasm-round-trip.mjs`: built as a WASI reactor, and driven from Node through these exports
+#define WEBVIEW_GUI_HEADER_ONLY
+#include "webview-gui/webview-gui.h"
+
+#include <string>
+#include <vector>
+
+using namespace webview_gui;
+
+static WebviewGui::UniquePtr gui;
+static uint32_t echoChannel = 0;
+static std::vector<unsigned char> message;
+static size_t receivedMessages = 0, receivedBytes = 0;
+static uint32_t receivedChecksum = 0;
+
+static void count(const unsigned char *bytes, size_t length) {
+	++receivedMessages;
+	receivedBytes += length;
+	for (size_t i = 0; i < length; ++i) receivedChecksum = receivedChecksum*31 + bytes[i];
+}
+
+extern "C" {
+	__attribute__((export_name("bench_open"))) void benchOpen() {
+		gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "/index.html", [](const char *path, WebviewGui::Resource &resource){
+			if (std::string(path) != "/index.html") return false;
+			std::string html = "<!DOCTYPE html><html></html>";
+			resource.bytes.assign(html.begin(), html.end());
+			return true;
+		});
+		gui->receive = count;
+		gui->receiveText = [](const char *text, size_t length){
+			count((const unsigned char *)text, length);
+		};
+		echoChannel = gui->channel("echo", count);
+	}
+	__attribute__((export_name("bench_close"))) void benchClose() {
+		gui = nullptr;
+	}
+	// Sends `messageCount` messages of `bytes` bytes each (`kind` 0 = plain, 1 = named channel, 2 = text), returning a checksum of what was sent
+	__attribute__((export_name("bench_send"))) uint32_t benchSend(size_t bytes, size_t messageCount, int kind) {
+		message.resize(bytes);
+		for (size_t i = 0; i < bytes; ++i) message[i] = (unsigned char)('a' + i%26);
+		uint32_t checksum = 0;
+		for (size_t m = 0; m < messageCount; ++m) {
+			message[0] = (unsigned char)('a' + m%26);
+			if (kind == 2) {
+				gui->sendText((const char *)message.data(), message.size());
+			} else {
+				gui->send(kind ? echoChannel : 0, message.data(), message.size());
+			}
+			for (auto b : message) checksum = checksum*31 + b;
+		}
+		return checksum;
+	}
+	__attribute__((export_name("bench_received_messages"))) size_t benchReceivedMessages() {
+		return receivedMessages;
+	}
+	__attribute__((export_name("bench_received_bytes"))) size_t benchReceivedBytes() {
+		return receivedBytes;
+	}
+	// Resets the counters, returning the checksum of everything received since the last reset
+	__attribute__((export_name("bench_reset"))) uint32_t benchReset() {
+		uint32_t checksum = receivedChecksum;
+		receivedMessages = receivedBytes = 0;
+		receivedChecksum = 0;
+		return checksum;
+	}
+}
@@ -0,0 +1,74 @@
+/* Round-trips through the wasm backend under Node, offline: a `MessageChannel` stands in for the frame boundary, and the page (using `webviewGuiPage()`) echoes everything.  Checks that what comes back matches what was sent, and prints one JSON object per line like the other benchmarks.
+
+	node benchmarks/wasm-round-trip.mjs path/to/webview-gui-bench-wasm-round-trip.wasm
+*/
+import {readFile} from 'node:fs/promises';
+import {WASI} from 'node:wasi';
+import {webviewGuiWasm, webviewGuiPage} from '../include/webview-gui/wasm.mjs';
+
+let wasmPath = process.argv[2];
+if (!wasmPath) {
+	console.error('usage: node wasm-round-trip.mjs <webview-gui-bench-wasm-round-trip.wasm>');
+	process.exit(2);
+}
+
+let {port1, port2} = new MessageChannel();
+let opened = null;
+let glue = webviewGuiWasm({
+	open: (startPath, fetch)=>{
+		opened = {startPath: startPath, resource: fetch(startPath), missing: fetch('/missing.js')};
+		return port1;
+	},
+	close: port=>port.close()
+});
+
+let page = webviewGuiPage(port2);
+page.addEventListener('message', e=>(typeof e.data == 'string') ? page.sendText(e.data) : page.send(e.data));
+let echo = page.channel('echo');
+echo.addEventListener('message', e=>echo.send(e.data));
+
+let wasi = new WASI({version: 'preview1'});
+let {instance} = await WebAssembly.instantiate(await readFile(wasmPath), {...glue.imports, wasi_snapshot_preview1: wasi.wasiImport});
+wasi.initialize(instance);
+glue.connect(instance);
+let bench = instance.exports;
+
+let failures = 0;
+let check = (condition, message)=>{
+	if (!condition) {
+		console.error('FAILED: ' + message);
+		++failures;
+	}
+};
+let untilReceived = async (count, timeoutMs)=>{
+	let start = performance.now();
+	while (bench.bench_received_messages() < count && performance.now() - start < timeoutMs) {
+		await new Promise(resolve=>setImmediate(resolve));
+	}
+};
+
+bench.bench_open();
+check(opened && opened.startPath == '/index.html', 'start path');
+check(opened.resource && opened.resource.mediaType == 'text/html' && new TextDecoder().decode(opened.resource.bytes).startsWith('<!DOCTYPE'), 'resource from the getter');
+check(opened.missing === null, 'missing resource');
+
+for (let [kind, name] of [[0, 'plain'], [1, 'channel'], [2, 'text']]) {
+	for (let bytes of [16, 256, 4096, 65536, 1048576]) {
+		if (kind == 2 && bytes > 65536) continue;
+		let count = Math.max(20, Math.min(20000, Math.floor((64 << 20)/bytes/8)));
+		bench.bench_reset();
+		let start = performance.now();
+		let sentChecksum = bench.bench_send(bytes, count, kind);
+		await untilReceived(count, 30000);
+		let seconds = (performance.now() - start)/1000;
+		let receivedBytes = Number(bench.bench_received_bytes()), receivedMessages = Number(bench.bench_received_messages());
+		check(receivedMessages == count, `${name} ${bytes}: received ${receivedMessages}/${count} messages`);
+		check(bench.bench_reset() == sentChecksum, `${name} ${bytes}: echoed bytes differ`);
+		console.log(JSON.stringify({benchmark: 'wasm-round-trip', kind: name, bytes: bytes, messages: count,
+			messagesPerSecond: count/seconds, mbPerSecond: receivedBytes/seconds/1e6}));
+	}
+}
+
+bench.bench_close();
+port2.close();
+if (failures) process.exit(1);
@@ -0,0 +1,96 @@
+// Open time of one webview, from `create()` to the page's first message
+// WebKitGTK's data store is its default context, under `$XDG_CACHE_HOME` and `$XDG_DATA_HOME` (`Options::dataDirectory` is macOS-only), so those choose where it is
+// Each launch has to be a fresh process (with fresh WebKit processes), so `run-cold-start-xvfb.sh` runs this repeatedly with the same XDG directories: the first launch is cold, the rest aren't
+// Usage: webview-gui-bench-webkitgtk-cold-start [label]
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+
+#include <gtk/gtk.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+
+static const char *pageHtml = R"HTML(<!DOCTYPE html>
+<html>
+	<head>
+		<link rel="stylesheet" href="style.css">
+		<script src="bundle.js"></script>
+	</head>
+	<body>
+		<script>
+			parent.postMessage(new Uint8Array([bundleChecksum() & 255]).buffer, '*');
+		</script>
+	</body>
+</html>)HTML";
+
+// A stand-in for a real GUI's (unminified) JS bundle, big enough that parsing and compiling it shows up
+static std::string bundleJs() {
+	std::string js;
+	for (int i = 0; i < 4000; ++i) {
+		auto n = std::to_string(i);
+		js += "function widget" + n + "(state) {\n\tlet sum = " + n + ";\n\tfor (let key in state) sum += String(state[key]).length;\n\treturn {id: 'widget" + n + "', sum: sum, render: () => '<div class=\"w" + n + "\">' + sum + '</div>'};\n}\n";
+	}
+	js += "function bundleChecksum() {\n\tlet total = 0;\n\tfor (let i = 0; i < 4000; ++i) total += window['widget' + i]({a: i}).sum;\n\treturn total;\n}\n";
+	return js;
+}
+static std::string styleCss() {
+	std::string css;
+	for (int i = 0; i < 4000; ++i) css += ".w" + std::to_string(i) + " { padding: " + std::to_string(i%7) + "px; color: #" + std::to_string(100 + i%900) + "; }\n";
+	return css;
+}
+
+// Runs the GTK loop until `done()` - returns `false` on timeout
+static bool pumpUntil(const std::function<bool()> &done, double timeoutSeconds) {
+	auto start = bench::Clock::now();
+	while (!done()) {
+		if (bench::secondsSince(start) > timeoutSeconds) return false;
+		g_main_context_iteration(nullptr, false);
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	std::string label = (argc > 1) ? argv[1] : "launch";
+	auto *cacheHome = std::getenv("XDG_CACHE_HOME");
+
+	if (!gtk_init_check(nullptr, nullptr)) {
+		std::fprintf(stderr, "No display - run this under Xvfb (see run-cold-start-xvfb.sh)\n");
+		return 1;
+	}
+
+	std::string bundle = bundleJs(), style = styleCss();
+	auto start = bench::Clock::now();
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "index.html", [&](const char *path, WebviewGui::Resource &resource){
+		std::string name = path;
+		if (name.size() && name[0] == '/') name = name.substr(1);
+		const std::string content = (name == "index.html") ? std::string(pageHtml) : (name == "bundle.js") ? bundle : (name == "style.css") ? style : "";
+		if (content.empty()) return false;
+		resource.bytes.assign(content.begin(), content.end());
+		return true;
+	});
+	if (!gui) {
+		std::fprintf(stderr, "Couldn't create WebKitGTK webview\n");
+		return 1;
+	}
+	double createSeconds = bench::secondsSince(start);
+
+	bool ready = false;
+	gui->receive = [&](const unsigned char *, size_t){
+		ready = true;
+	};
+	if (!pumpUntil([&](){return ready;}, 60)) {
+		std::fprintf(stderr, "Page didn't load\n");
+		return 1;
+	}
+	double readySeconds = bench::secondsSince(start);
+
+	bench::Result("webkitgtk-cold-start").add("launch", label)
+		.add("xdgCacheHome", cacheHome ? cacheHome : "")
+		.add("createMs", createSeconds*1e3)
+		.add("domContentLoadedMs", gui->timeline.secondsUntil("dom-content-loaded")*1e3)
+		.add("readyMs", readySeconds*1e3)
+		.add("bundleBytes", bundle.size());
+}
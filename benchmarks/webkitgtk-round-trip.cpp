@@ -0,0 +1,143 @@
+// End-to-end round trips through the real Linux (CHOC/WebKitGTK) backend:
+//     C++ send() -> evaluateJavascript -> page -> postMessage() -> _WebviewGui_receive64 -> receive()
+// This needs a display, so run it headless with `run-webkitgtk-xvfb.sh`
+#include "webview-gui/webview-gui.h"
+#include "./bench.h"
+
+#include <gtk/gtk.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+// Echoes everything back, after first saying it's ready
+static const char *pageHtml = R"HTML(<!DOCTYPE html>
+<html>
+	<body>
+		<script>
+			addEventListener('message', e=>parent.postMessage(e.data, '*'));
+			parent.postMessage(new Uint8Array([0]).buffer, '*');
+		</script>
+	</body>
+</html>)HTML";
+
+// Runs the GTK loop until `done()` - returns `false` on timeout
+static bool pumpUntil(const std::function<bool()> &done, double timeoutSeconds) {
+	auto start = bench::Clock::now();
+	while (!done()) {
+		if (bench::secondsSince(start) > timeoutSeconds) return false;
+		g_main_context_iteration(nullptr, false);
+	}
+	return true;
+}
+
+struct RoundTrips {
+	std::vector<bench::Clock::time_point> sendTimes;
+	std::vector<double> latencies;
+	size_t bytesReceived = 0;
+
+	void reset(size_t count) {
+		sendTimes.assign(count, {});
+		latencies.clear();
+		latencies.reserve(count);
+		bytesReceived = 0;
+	}
+	void send(WebviewGui &gui, std::vector<unsigned char> &message, uint64_t index) {
+		std::memcpy(message.data(), &index, sizeof(index));
+		sendTimes[index] = bench::Clock::now();
+		gui.send(message.data(), message.size());
+	}
+	void receive(const unsigned char *bytes, size_t length) {
+		uint64_t index;
+		std::memcpy(&index, bytes, sizeof(index));
+		if (index >= sendTimes.size()) return;
+		latencies.push_back(bench::secondsSince(sendTimes[index]));
+		bytesReceived += length;
+	}
+	double percentileMs(double p) {
+		if (latencies.empty()) return -1;
+		auto sorted = latencies;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[std::min(sorted.size() - 1, size_t(p*sorted.size()))]*1e3;
+	}
+};
+
+int main() {
+	if (!gtk_init_check(nullptr, nullptr)) {
+		std::fprintf(stderr, "No display - run this under Xvfb (see run-webkitgtk-xvfb.sh)\n");
+		return 1;
+	}
+
+	auto gui = WebviewGui::createUnique(WebviewGui::X11EMBED, "index.html", [](const char *path, WebviewGui::Resource &resource){
+		resource.mediaType = "text/html;charset=utf-8";
+		resource.bytes.assign(pageHtml, pageHtml + std::strlen(pageHtml));
+		return true;
+	});
+	if (!gui) {
+		std::fprintf(stderr, "Couldn't create WebKitGTK webview\n");
+		return 1;
+	}
+
+	bool ready = false;
+	RoundTrips roundTrips;
+	gui->receive = [&](const unsigned char *bytes, size_t length){
+		if (length < sizeof(uint64_t)) {
+			ready = true;
+		} else {
+			roundTrips.receive(bytes, length);
+		}
+	};
+	if (!pumpUntil([&](){return ready;}, 30)) {
+		std::fprintf(stderr, "Page didn't load\n");
+		return 1;
+	}
+	bench::Result("webkitgtk-startup").add("readySeconds", gui->timeline.secondsUntil("first-receive"));
+
+	for (size_t messageSize : {size_t(16), size_t(1024), size_t(16384), size_t(262144)}) {
+		std::vector<unsigned char> message(messageSize);
+		for (size_t i = 0; i < messageSize; ++i) message[i] = (unsigned char)(i*31);
+
+		// Latency at fixed message rates
+		for (double rate : {10.0, 100.0, 1000.0}) {
+			size_t count = std::min<size_t>(size_t(rate*2), 500);
+			roundTrips.reset(count);
+			auto start = bench::Clock::now();
+			for (size_t i = 0; i < count; ++i) {
+				auto due = start + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(i/rate));
+				pumpUntil([&](){return bench::Clock::now() >= due;}, 60);
+				roundTrips.send(*gui, message, i);
+			}
+			bool complete = pumpUntil([&](){return roundTrips.latencies.size() == count;}, 30);
+			bench::Result("webkitgtk-latency").add("bytes", messageSize).add("rate", rate).add("messages", count)
+				.add("received", roundTrips.latencies.size())
+				.add("complete", complete ? "true" : "false")
+				.add("p50ms", roundTrips.percentileMs(0.5))
+				.add("p90ms", roundTrips.percentileMs(0.9))
+				.add("p99ms", roundTrips.percentileMs(0.99))
+				.add("maxMs", roundTrips.percentileMs(1));
+		}
+
+		// Sustained throughput, with a bounded number of messages in flight
+		{
+			size_t count = std::max<size_t>(50, (size_t(32) << 20)/messageSize/4);
+			size_t inFlight = 32;
+			roundTrips.reset(count);
+			auto start = bench::Clock::now();
+			size_t sent = 0;
+			bool complete = pumpUntil([&](){
+				while (sent < count && sent - roundTrips.latencies.size() < inFlight) {
+					roundTrips.send(*gui, message, sent++);
+				}
+				return roundTrips.latencies.size() == count;
+			}, 120);
+			double seconds = bench::secondsSince(start);
+			bench::Result("webkitgtk-throughput").add("bytes", messageSize).add("messages", count)
+				.add("complete", complete ? "true" : "false")
+				.add("messagesPerSecond", roundTrips.latencies.size()/seconds)
+				.add("mbPerSecond", roundTrips.bytesReceived/seconds/1e6)
+				.add("p50ms", roundTrips.percentileMs(0.5))
+				.add("p99ms", roundTrips.percentileMs(0.99));
+		}
+	}
+}
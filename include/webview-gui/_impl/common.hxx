@@ -0,0 +1,397 @@
+#pragma once
+
+/* Platform-independent parts of `WebviewGui`.
+
+These are built on methods which every platform's `Impl` provides:
+	void send(uint32_t channel, const unsigned char *, size_t) - calls `_WebviewGui_send64(base64, channel)` in the page
+	void sendText(const char *, size_t) - calls `_WebviewGui_sendText(string)` in the page (see `helpers::appendJsonString()`)
+	void announceChannel(const std::string &name, uint32_t channel) - calls `_WebviewGui_channelId(name, channel)` in the page
+	void setVisible(bool visible, double memoryPressureSeconds) - calls `_WebviewGui_setVisible(visible, seconds)` in the page
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)>) - calls back with a PNG of the rendered page, or empty
+	void showPlaceholder(const std::vector<unsigned char> &png) - shows an image above the page until its first paint (the platform watches for the "first-paint" event)
+	void memoryPressure(std::function<void()> cleared) - clears the platform's in-memory caches (where possible) and calls `_WebviewGui_memoryPressure()` in the page, then calls `cleared()` once the caches are cleared (straight away if that's synchronous, and never if the `Impl` is destroyed first)
+and the platform passes everything from `_WebviewGui_receive64()` to `WebviewGui::receive64()` (or binary messages to `WebviewGui::receiveBinary()`, where it has bytes), and reports resource requests to `WebviewGui::resourceRequested()`.
+*/
+
+#include "../helpers.h"
+
+#include <cstdlib>
+#include <fstream>
+
+#ifdef __linux__
+#	include <dirent.h>
+#	include <unistd.h>
+#	include <vector>
+#endif
+
+namespace webview_gui {
+
+WebviewGui::ResourceGetter WebviewGui::fileGetter(const std::string &baseDir) {
+	return [baseDir](const char *path, Resource &resource){
+		auto fullPath = baseDir + path;
+#ifdef _WIN32
+		for (size_t i = baseDir.size(); i < fullPath.size(); ++i) {
+			if (fullPath[i] == '/') fullPath[i] = '\\';
+		}
+#endif
+		std::ifstream fileStream{fullPath, std::ios::binary | std::ios::ate};
+		if (!fileStream) return false;
+		size_t length = fileStream.tellg();
+		resource.bytes.resize(length);
+		fileStream.seekg(0);
+		fileStream.read((char *)resource.bytes.data(), length);
+		return bool(fileStream);
+	};
+}
+
+void WebviewGui::send(const unsigned char *bytes, size_t length) {
+	if (!visible && holdWhileHidden) {
+		hold({0, {}, {bytes, bytes + length}});
+		return;
+	}
+	sendToImpl(0, bytes, length);
+}
+void WebviewGui::sendState(const std::string &key, const unsigned char *bytes, size_t length) {
+	if (!visible && holdWhileHidden) {
+		// Only the latest state for each key is kept, in the position it was most recently sent
+		for (auto iter = held.begin(); iter != held.end(); ++iter) {
+			if (iter->key == key) {
+				held.erase(iter);
+				break;
+			}
+		}
+		hold({0, key, {bytes, bytes + length}});
+		return;
+	}
+	sendToImpl(0, bytes, length);
+}
+
+void WebviewGui::hold(HeldMessage &&message) {
+	if (maxHeldMessages && held.size() >= maxHeldMessages) {
+		// The oldest plain message goes (states are already one per key)
+		for (auto iter = held.begin(); iter != held.end(); ++iter) {
+			if (iter->key.empty()) {
+				held.erase(iter);
+				metrics.droppedHeld();
+				break;
+			}
+		}
+	}
+	held.push_back(std::move(message));
+	metrics.held(held.size());
+}
+
+void WebviewGui::sendText(const char *text, size_t length) {
+	if (!visible && holdWhileHidden) {
+		hold({0, {}, {text, text + length}, true});
+		return;
+	}
+	if (recorder) recorder->record(Recorder::Type::SEND_TEXT, 0, text, length);
+	auto encodeStart = Metrics::now();
+	ScratchScope scope{*this};
+	impl->sendText(text, length);
+	metrics.sent(length, encodeStart);
+}
+
+uint32_t WebviewGui::channel(const std::string &name) {
+	for (size_t i = 0; i < channels.size(); ++i) {
+		if (channels[i].name == name) return uint32_t(i + 1);
+	}
+	Channel entry;
+	entry.name = name;
+	channels.push_back(std::move(entry));
+	if (recorder) recorder->record(Recorder::Type::CHANNEL, uint32_t(channels.size()), name.data(), name.size());
+	return uint32_t(channels.size());
+}
+uint32_t WebviewGui::channel(const std::string &name, std::function<void(const unsigned char *, size_t)> handler) {
+	auto id = channel(name);
+	auto &entry = channels[id - 1];
+	if (entry.running) {
+		entry.replacement = std::move(handler);
+		entry.replaced = true;
+	} else {
+		entry.handler = std::move(handler);
+	}
+	return id;
+}
+void WebviewGui::callChannel(Channel &entry, const unsigned char *bytes, size_t length) {
+	++entry.running;
+	entry.handler(bytes, length);
+	if (!--entry.running && entry.replaced) {
+		entry.handler = std::move(entry.replacement);
+		entry.replacement = nullptr;
+		entry.replaced = false;
+	}
+}
+void WebviewGui::send(uint32_t channelId, const unsigned char *bytes, size_t length) {
+	if (channelId > channels.size()) return;
+	if (!visible && holdWhileHidden) {
+		hold({channelId, {}, {bytes, bytes + length}});
+		return;
+	}
+	sendToImpl(channelId, bytes, length);
+}
+void WebviewGui::sendToImpl(uint32_t channelId, const unsigned char *bytes, size_t length) {
+	ScratchScope scope{*this};
+	if (channelId) {
+		auto &entry = channels[channelId - 1];
+		// If we send first, the page won't have asked for the ID yet
+		if (!entry.announced) impl->announceChannel(entry.name, channelId);
+		entry.announced = true;
+	}
+	if (recorder) recorder->record(Recorder::Type::SEND, channelId, bytes, length);
+	auto encodeStart = Metrics::now();
+	impl->send(channelId, bytes, length);
+	metrics.sent(length, encodeStart);
+}
+
+void WebviewGui::probeLatency() {
+	if (!Metrics::enabled) return;
+	if (!probeChannel) {
+		// The runtime echoes anything on this channel
+		probeChannel = channel("webview-gui/probe", [this](const unsigned char *bytes, size_t length){
+			if (length != 8) return;
+			uint64_t sentNanos = 0;
+			for (int i = 7; i >= 0; --i) sentNanos = (sentNanos << 8) + bytes[i];
+			auto nowNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(Metrics::Clock::now().time_since_epoch()).count();
+			metrics.roundTripSeconds(double(uint64_t(nowNanos) - sentNanos)*1e-9);
+		});
+	}
+	auto nanos = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Metrics::Clock::now().time_since_epoch()).count());
+	unsigned char bytes[8];
+	for (int i = 0; i < 8; ++i) bytes[i] = (unsigned char)(nanos >> (i*8));
+	send(probeChannel, bytes, 8);
+}
+
+void WebviewGui::receive64(const char *base64) {
+	if (base64[0] == '?') {
+		auto channelId = channel(base64 + 1);
+		channels[channelId - 1].announced = true;
+		ScratchScope scope{*this};
+		impl->announceChannel(channels[channelId - 1].name, channelId);
+		return;
+	}
+	if (base64[0] == '!') {
+		// Only sent while hidden, but we might have been shown since
+		if (!std::strcmp(base64 + 1, "memory-pressure") && !visible) memoryPressure();
+		return;
+	}
+	if (base64[0] == '\'') {
+		// Text, with no decoding at all
+		auto *text = base64 + 1;
+		size_t length = std::strlen(text);
+		if (!receiveText && !receive) return;
+		markFirstReceive();
+		metrics.received(length, Metrics::now());
+		if (recorder) recorder->record(Recorder::Type::RECEIVE_TEXT, 0, text, length);
+		if (receiveText) {
+			receiveText(text, length);
+		} else {
+			receive((const unsigned char *)text, length);
+		}
+		return;
+	}
+	// Base64 never contains ':', so a leading "{digits}:" must be a channel ID
+	uint32_t channelId = 0;
+	const char *data = base64;
+	while (*data >= '0' && *data <= '9') {
+		channelId = channelId*10 + uint32_t(*data - '0');
+		++data;
+	}
+	if (*data == ':') {
+		++data;
+	} else {
+		channelId = 0;
+		data = base64;
+	}
+
+	if (!channelId && plainReceiver.base64) return plainReceiver.base64(plainReceiver.context, data);
+	if (channelId > channels.size()) return;
+	auto &handler = channelId ? channels[channelId - 1].handler : receive;
+	if (!handler && !receiveQueue) return;
+	markFirstReceive();
+
+	if (!handler) {
+		// No intermediate buffer: straight into the queue's memory (or dropped, if it's full)
+		auto decodeStart = Metrics::now();
+		size_t length = helpers::decodedBase64Length(data);
+		if (auto *bytes = receiveQueue->reserve(channelId, length)) {
+			helpers::decodeBase64(data, bytes);
+			if (recorder) recorder->record(Recorder::Type::RECEIVE, channelId, bytes, length);
+			receiveQueue->commit();
+		}
+		metrics.received(length, decodeStart);
+		return;
+	}
+
+	std::vector<unsigned char> nestedBuffer;
+	auto &binary = receiving ? nestedBuffer : receiveBuffer;
+	bool outermost = !receiving;
+	receiving = true;
+	binary.clear();
+	auto decodeStart = Metrics::now();
+	helpers::decodeBase64(data, binary);
+	metrics.received(binary.size(), decodeStart);
+	if (recorder) recorder->record(Recorder::Type::RECEIVE, channelId, binary.data(), binary.size());
+	if (channelId) {
+		callChannel(channels[channelId - 1], binary.data(), binary.size());
+	} else {
+		receive(binary.data(), binary.size());
+	}
+	if (outermost) receiving = false;
+}
+
+void WebviewGui::receiveBinary(uint32_t channelId, const unsigned char *bytes, size_t length) {
+	if (!channelId && plainReceiver.binary) return plainReceiver.binary(plainReceiver.context, bytes, length);
+	if (channelId > channels.size()) return;
+	auto &handler = channelId ? channels[channelId - 1].handler : receive;
+	if (!handler && !receiveQueue) return;
+	markFirstReceive();
+	metrics.received(length, Metrics::now());
+	if (recorder) recorder->record(Recorder::Type::RECEIVE, channelId, bytes, length);
+	if (handler) {
+		if (channelId) {
+			callChannel(channels[channelId - 1], bytes, length);
+		} else {
+			receive(bytes, length);
+		}
+	} else {
+		receiveQueue->push(channelId, bytes, length);
+	}
+}
+
+void WebviewGui::serveTelemetry(const std::string &name, std::shared_ptr<Telemetry> telemetry) {
+	for (auto &pair : telemetryStreams) {
+		if (pair.first == name) {
+			pair.second = std::move(telemetry);
+			return;
+		}
+	}
+	telemetryStreams.emplace_back(name, std::move(telemetry));
+}
+bool WebviewGui::telemetryResource(const char *path, Resource &resource) {
+	static constexpr const char *prefix = "_webview-gui/telemetry/";
+	static const size_t prefixLength = std::strlen(prefix);
+	// Only at the start of the path, so it can't shadow the plugin's own resources
+	if (*path == '/') ++path;
+	if (std::strncmp(path, prefix, prefixLength)) return false;
+	auto *name = path + prefixLength;
+	// The page adds a query string, so nothing in between caches it
+	size_t nameLength = std::strcspn(name, "?#");
+	for (auto &pair : telemetryStreams) {
+		if (pair.second && pair.first.size() == nameLength && !std::memcmp(pair.first.data(), name, nameLength)) {
+			resource.mediaType = "application/octet-stream";
+			pair.second->latest(resource.bytes);
+			return true;
+		}
+	}
+	return false;
+}
+
+void WebviewGui::resourceRequested(const char *path, bool found, const Resource &resource, Timeline::Clock::time_point getterStart) {
+	metrics.resource(found, resource.bytes.size(), resource.fromCache, getterStart);
+	if (recorder) recorder->record(Recorder::Type::RESOURCE, found ? uint32_t(resource.bytes.size()) : Recorder::notFound, path, std::strlen(path));
+}
+
+std::string WebviewGui::defaultDataDirectory(const std::string &id) {
+	std::string name = id;
+	for (auto &c : name) {
+		bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+		if (!safe) c = '_';
+	}
+#if defined(_WIN32) || defined(_WIN64)
+	auto *localAppData = std::getenv("LOCALAPPDATA");
+	if (!localAppData || !*localAppData) return {};
+	return std::string(localAppData) + "\\webview-gui\\" + name;
+#else
+	std::string base;
+	auto *home = std::getenv("HOME");
+#	ifdef __APPLE__
+	if (home && *home) base = std::string(home) + "/Library/Caches";
+#	else
+	auto *cacheHome = std::getenv("XDG_CACHE_HOME");
+	if (cacheHome && *cacheHome) {
+		base = cacheHome;
+	} else if (home && *home) {
+		base = std::string(home) + "/.cache";
+	}
+#	endif
+	if (base.empty()) return {};
+	return base + "/webview-gui/" + name;
+#endif
+}
+
+void WebviewGui::setVisible(bool isVisible) {
+	visible = isVisible;
+	impl->setVisible(visible, memoryPressureAfterHidden);
+	if (visible && !held.empty()) {
+		// Catch up on everything we held back
+		auto replay = std::move(held);
+		held.clear();
+		metrics.held(0);
+		for (auto &message : replay) {
+			if (message.text) {
+				sendText((const char *)message.bytes.data(), message.bytes.size());
+			} else {
+				sendToImpl(message.channel, message.bytes.data(), message.bytes.size());
+			}
+		}
+	}
+}
+
+void WebviewGui::captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+	impl->captureSnapshot(std::move(callback));
+}
+void WebviewGui::showPlaceholder(const std::vector<unsigned char> &png) {
+	if (!png.empty()) impl->showPlaceholder(png);
+}
+
+// Resident bytes for this process and its WebKit descendants (the web and network processes, possibly under a sandbox launcher), or 0 where we can't measure it
+static size_t residentBytes() {
+#ifdef __linux__
+	auto pageSize = size_t(sysconf(_SC_PAGESIZE));
+	auto residentPages = [](const std::string &procDir) -> size_t {
+		std::ifstream statm{procDir + "/statm"};
+		size_t total = 0, resident = 0;
+		statm >> total >> resident;
+		return resident;
+	};
+	size_t pages = residentPages("/proc/self");
+
+	// Walk our descendants through each thread's `children` list (without `CONFIG_PROC_CHILDREN`, that's none), instead of scanning every process
+	std::vector<std::string> pending{"self"};
+	for (size_t i = 0; i < pending.size() && i < 256; ++i) {
+		std::string procDir = "/proc/" + pending[i];
+		if (i > 0) {
+			std::ifstream commFile{procDir + "/comm"};
+			std::string comm;
+			std::getline(commFile, comm);
+			if (!comm.compare(0, 6, "WebKit")) pages += residentPages(procDir);
+		}
+		if (auto *dir = opendir((procDir + "/task").c_str())) {
+			while (auto *entry = readdir(dir)) {
+				if (entry->d_name[0] == '.') continue;
+				std::ifstream childrenFile{procDir + "/task/" + entry->d_name + "/children"};
+				std::string pid;
+				while (childrenFile >> pid) pending.push_back(pid);
+			}
+			closedir(dir);
+		}
+	}
+	return pages*pageSize;
+#else
+	return 0;
+#endif
+}
+
+void WebviewGui::memoryPressure(std::function<void(MemoryReport)> callback) {
+	MemoryReport report;
+	report.rssBefore = residentBytes();
+	impl->memoryPressure([this, report, callback]() mutable {
+		report.rssAfter = residentBytes();
+		lastMemoryReport = report;
+		if (callback) callback(report);
+	});
+}
+
+} // namespace
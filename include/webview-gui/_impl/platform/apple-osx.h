@@ -1,12 +1,20 @@
 #pragma once
 
 #include "../../helpers.h"
+#include "../runtime-js.h"
 
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreGraphics/CGGeometry.h>
 #include <objc/runtime.h>
 #include <objc/message.h>
 
+#include <cstdlib>
+#include <functional>
+#include <memory>
+
+extern "C" void *_NSConcreteMallocBlock[32];
+extern "C" void _Block_release(const void *);
+
 namespace webview_gui {
 
 // Objective-C helpers - we use `objc_msgSend` for "simple" return values (not structs, not floating-point)
@@ -42,6 +50,32 @@ namespace _objc {
 		return callSimple<bool>(obj, "isKindOfClass:", (id)objc_getClass(className));
 	}
 	
+	// A heap block wrapping a C++ function, for completion handlers which need state - release it with `_Block_release()` once it's been passed on
+	template<class... Args>
+	id makeBlock(std::function<void(Args...)> fn) {
+		struct Descriptor {
+			unsigned long reserved, size;
+			void (*copy)(void *, const void *);
+			void (*dispose)(const void *);
+		};
+		struct Block {
+			void *isa;
+			int flags, reserved;
+			void (*invoke)(Block *, Args...);
+			const Descriptor *descriptor;
+			std::function<void(Args...)> *fn; // the "captured" variable
+		};
+		static const Descriptor descriptor{0, sizeof(Block), [](void *, const void *){}, [](const void *block){
+			delete ((const Block *)block)->fn;
+		}};
+		auto *block = (Block *)std::malloc(sizeof(Block));
+		// BLOCK_NEEDS_FREE | BLOCK_HAS_COPY_DISPOSE, with a reference count of 1 (stored doubled)
+		*block = {_NSConcreteMallocBlock, (1 << 24) | (1 << 25) | 2, 0, [](Block *block, Args... args){
+			(*block->fn)(args...);
+		}, &descriptor, new std::function<void(Args...)>(std::move(fn))};
+		return (id)block;
+	}
+
 	struct ScopedRelease {
 		id obj;
 		ScopedRelease(id obj) : obj(obj) {}
@@ -57,6 +91,12 @@ struct WebviewGui::Impl {
 	id webview = nullptr;
 	id messageHandler = nullptr, schemeHandler = nullptr;
 	ResourceGetter getter;
+	double width = 100, height = 100;
+	id placeholder = nullptr;
+	bool painted = false;
+
+	// Milestones from before `main` exists are kept until the `WebviewGui` is constructed
+	PendingTimeline timeline;
 
 	static constexpr const char * associatedObjectKey = "WebviewGui::Impl";
 
@@ -65,15 +105,23 @@ struct WebviewGui::Impl {
 		auto *impl = (Impl *)objc_getAssociatedObject(self, associatedObjectKey);
 		if (!impl || !impl->main) return;
 
-		auto &receiveFn = impl->main->receive;
-		if (!receiveFn) return;
-
 		id body = callSimple(message, "body");
-		if (instanceOf(body, "NSString")) {
-			auto *base64 = callSimple<const char *>(body, "UTF8String");
-			auto binary = helpers::decodeBase64(base64);
-			receiveFn((const unsigned char *)binary.data(), binary.size());
+		if (!instanceOf(body, "NSString")) return;
+		auto *bodyStr = callSimple<const char *>(body, "UTF8String");
+		auto *nameStr = callSimple<const char *>(callSimple(message, "name"), "UTF8String");
+		if (nameStr && !std::strcmp(nameStr, "webviewGui_event")) {
+			// "{name}\n{detail}"
+			auto *split = std::strchr(bodyStr, '\n');
+			std::string name = split ? std::string(bodyStr, split) : std::string(bodyStr);
+			impl->main->timeline.mark(name, split ? split + 1 : "");
+			if (name == "first-paint") {
+				impl->painted = true;
+				impl->removePlaceholder();
+			}
+			return;
 		}
+
+		impl->main->receive64(bodyStr);
 	}
 	
 	static id createMessageHandlerClass() {
@@ -99,8 +147,15 @@ struct WebviewGui::Impl {
 		auto *urlStr = callSimple<const char *>(callSimple(url, "absoluteString"), "UTF8String");
 		auto *pathStr = urlStr + std::strlen("webview-gui://"); // using `path` or similar will remove trailing `/`
 		Resource resource;
-		resource.mediaType = helpers::guessMediaType(pathStr);
-		if (!impl->getter(pathStr, resource)) {
+		bool found = impl->main->telemetryResource(pathStr, resource);
+		if (!found) {
+			resource.mediaType = helpers::guessMediaType(pathStr);
+			auto getterStart = Timeline::Clock::now();
+			found = impl->getter(pathStr, resource);
+			impl->timeline.add("resource", getterStart, pathStr);
+			impl->main->resourceRequested(pathStr, found, resource, getterStart);
+		}
+		if (!found) {
 			id response = callSimple("NSHTTPURLResponse", "alloc");
 			SCOPED_RELEASE(response);
 			response = callSimple(
@@ -153,7 +208,8 @@ struct WebviewGui::Impl {
 		return (id)objc_getClass(className);
 	}
 
-	Impl(ResourceGetter g={}) {
+	Impl(ResourceGetter g={}, const Options &options={}) {
+		auto constructStart = Timeline::Clock::now();
 		getter = std::move(g);
 
 		using namespace _objc;
@@ -164,6 +220,24 @@ struct WebviewGui::Impl {
 		// Wait until everything's ready until showing anything
 		callVoid(config, "setSuppressesIncrementalRendering:", nsNumber(true));
 		
+		// Each data directory gets its own persistent store (macOS 14+), identified by a UUID hashed from the path - WebKit decides where it's kept
+		if (options.dataDirectory.size()) {
+			unsigned char uuidBytes[16];
+			uint64_t hashes[2] = {14695981039346656037ull, 14695981039346656037ull ^ 0x9e3779b97f4a7c15ull};
+			for (auto &hash : hashes) {
+				for (unsigned char c : options.dataDirectory) hash = (hash ^ c)*1099511628211ull; // FNV-1a
+			}
+			for (int i = 0; i < 16; ++i) uuidBytes[i] = (unsigned char)(hashes[i/8] >> (8*(i%8)));
+			uuidBytes[6] = (uuidBytes[6]&0x0f) | 0x80; // version 8 (custom)
+			uuidBytes[8] = (uuidBytes[8]&0x3f) | 0x80; // RFC 4122 variant
+			id uuid = callSimple("NSUUID", "alloc");
+			SCOPED_RELEASE(uuid);
+			if (uuid) uuid = callSimple(uuid, "initWithUUIDBytes:", (const unsigned char *)uuidBytes);
+			// Earlier versions don't have this, and keep the (also persistent) default store
+			id dataStore = callSimple("WKWebsiteDataStore", "dataStoreForIdentifier:", uuid);
+			if (dataStore) callVoid(config, "setWebsiteDataStore:", dataStore);
+		}
+		
 		if (getter) {
 			static id schemeHandlerClass = createSchemeHandlerClass();
 			schemeHandler = callSimple(schemeHandlerClass, "new");
@@ -177,53 +251,139 @@ struct WebviewGui::Impl {
 		callVoid(preferences, "setJavaScriptCanOpenWindowsAutomatically:", nsNumber(false));
 		
 		id contentController = callSimple(config, "userContentController");
-		const char *initJs = R"JS(
-			if (!Uint8Array.prototype.toBase64) {
-				Uint8Array.prototype.toBase64 = function() {
-					let binaryString = "";
-					for (var i = 0; i < this.length; i++) {
-						binaryString += String.fromCharCode(this[i]);
-					}
-					return btoa(binaryString);
-				};
+		std::string initJs = R"JS(
+			function _WebviewGui_receive64(b64) {
+				window.webkit.messageHandlers.webviewGui_receive.postMessage(b64);
 			}
-			if (!Uint8Array.fromBase64) {
-				Uint8Array.fromBase64 = b64 => {
-					let binaryString = atob(b64);
-					let array = new Uint8Array(b64.length);
-					for (let i=0; i < array.length; ++i) {
-						array[i] = binaryString.charCodeAt(i);
-					}
-					return array;
-				};
+			function _WebviewGui_event(name, detail) {
+				window.webkit.messageHandlers.webviewGui_event.postMessage(name + "\n" + detail);
 			}
-			window.addEventListener('message', e=>{
-				if (e.source == window) { // this happens if we attempt to send using `window.parent` from the main frame
-					e.stopImmediatePropagation();
-					let data = e.data;
-					if (data instanceof ArrayBuffer) data = new Uint8Array(data);
-					window.webkit.messageHandlers.webviewGui_receive.postMessage(data.toBase64());
-				}
-			}, {capture: true});
 		)JS";
+		initJs += _js::runtime;
 		id initScript = callSimple("WKUserScript", "alloc");
 		SCOPED_RELEASE(initScript);
-		if (initScript) initScript = callSimple(initScript, "initWithSource:injectionTime:forMainFrameOnly:", nsString(initJs), int(0)/*WKUserScriptInjectionTimeAtDocumentStart*/, true);
+		if (initScript) initScript = callSimple(initScript, "initWithSource:injectionTime:forMainFrameOnly:", nsString(initJs.c_str()), int(0)/*WKUserScriptInjectionTimeAtDocumentStart*/, true);
 		if (!initScript) return;
 		callSimple(contentController, "addUserScript:", initScript);
 		
 		messageHandler = callSimple(messageHandlerClass, "new");
 		objc_setAssociatedObject(messageHandler, associatedObjectKey, (id)this, OBJC_ASSOCIATION_ASSIGN);
 		callSimple(contentController, "addScriptMessageHandler:name:", messageHandler, nsString("webviewGui_receive"));
+		callSimple(contentController, "addScriptMessageHandler:name:", messageHandler, nsString("webviewGui_event"));
 		callVoid(messageHandler, "release");
 		
+		auto webviewStart = Timeline::Clock::now();
 		webview = callSimple("WKWebView", "alloc");
 		CGRect frame{{0, 0}, {100, 100}};
 		if (webview) webview = callSimple(webview, "initWithFrame:configuration:", frame, config);
+		timeline.add("webview-create", webviewStart);
+		timeline.add("impl-construct", constructStart);
 	}
 	
+	void evaluate(const char *js) {
+		using namespace _objc;
+		callSimple(webview, "evaluateJavaScript:completionHandler:", nsString(js), (id)nullptr);
+	}
+	// Scripts are built in the per-instance scratch arena (`std::to_string()` of a channel fits in the small-string buffer)
+	helpers::ArenaString scratchString() {
+		return helpers::ArenaString{helpers::ArenaAllocator<char>(&main->scratch)};
+	}
+	void send(uint32_t channel, const unsigned char *bytes, size_t length) {
+		auto js = scratchString();
+		js += "_WebviewGui_send64('";
+		helpers::encodeBase64(bytes, length, js);
+		js += "',";
+		js += std::to_string(channel).c_str();
+		js += ")";
+		evaluate(js.c_str());
+	}
+	void sendText(const char *text, size_t length) {
+		auto js = scratchString();
+		js += "_WebviewGui_sendText(";
+		helpers::appendJsonString(js, text, length);
+		js += ")";
+		evaluate(js.c_str());
+	}
+	void announceChannel(const std::string &name, uint32_t channel) {
+		auto js = scratchString();
+		js += "_WebviewGui_channelId(";
+		helpers::appendJsonString(js, name.data(), name.size());
+		js += ",";
+		js += std::to_string(channel).c_str();
+		js += ")";
+		evaluate(js.c_str());
+	}
+	void setVisible(bool visible, double memoryPressureSeconds) {
+		using namespace _objc;
+		// A hidden WKWebView is treated as not visible, so WebKit stops animation frames and throttles timers
+		if (!visible) evaluate(("_WebviewGui_setVisible(false," + std::to_string(memoryPressureSeconds) + ")").c_str());
+		callVoid(webview, "setHidden:", !visible);
+		if (visible) evaluate("_WebviewGui_setVisible(true)");
+	}
+	void memoryPressure(std::function<void()> cleared) {
+		using namespace _objc;
+		// The memory cache belongs to the data store, not the view
+		id dataStore = callSimple(callSimple(webview, "configuration"), "websiteDataStore");
+		id types = callSimple("NSSet", "setWithObject:", nsString("WKWebsiteDataTypeMemoryCache"));
+		// The data store can outlive us, so the completion only calls back while we're still around
+		std::weak_ptr<bool> weakAlive = alive;
+		id block = makeBlock(std::function<void()>{[weakAlive, cleared](){
+			if (weakAlive.lock()) cleared();
+		}});
+		callVoid(dataStore, "removeDataOfTypes:modifiedSince:completionHandler:", types, callSimple("NSDate", "distantPast"), block);
+		_Block_release(block);
+		evaluate("_WebviewGui_memoryPressure()");
+	}
+	std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		using namespace _objc;
+		// Called with an NSImage (or nil, e.g. if the view's gone), which we convert to PNG
+		id block = makeBlock(std::function<void(id, id)>{[callback](id image, id /*error*/){
+			id tiff = callSimple(image, "TIFFRepresentation");
+			id bitmap = callSimple("NSBitmapImageRep", "imageRepWithData:", tiff);
+			id data = callSimple(bitmap, "representationUsingType:properties:", (unsigned long)4/*NSBitmapImageFileTypePNG*/, callSimple("NSDictionary", "dictionary"));
+			auto *bytes = callSimple<const unsigned char *>(data, "bytes");
+			auto length = callSimple<unsigned long>(data, "length");
+			callback(bytes ? std::vector<unsigned char>(bytes, bytes + length) : std::vector<unsigned char>{});
+		}});
+		// Without `respondsToSelector:` (pre-10.13), the block would never be called
+		if (class_respondsToSelector(object_getClass(webview), sel_registerName("takeSnapshotWithConfiguration:completionHandler:"))) {
+			callVoid(webview, "takeSnapshotWithConfiguration:completionHandler:", (id)nullptr, block);
+		} else {
+			callback({});
+		}
+		_Block_release(block);
+	}
+	void showPlaceholder(const std::vector<unsigned char> &png) {
+		using namespace _objc;
+		if (painted) return;
+		removePlaceholder();
+		id data = callSimple("NSData", "dataWithBytes:length:", (const void *)png.data(), (unsigned long)png.size());
+		id image = callSimple(callSimple("NSImage", "alloc"), "initWithData:", data);
+		if (!image) return;
+		SCOPED_RELEASE(image);
+		placeholder = callSimple("NSImageView", "imageViewWithImage:", image);
+		if (!placeholder) return;
+		callVoid(placeholder, "retain");
+		callVoid(placeholder, "setImageScaling:", (unsigned long)1/*NSImageScaleAxesIndependently*/);
+		// A subview of the webview, so it follows it around, and covers the (not yet rendered) page
+		CGRect frame{{0, 0}, {width, height}};
+		callVoid(placeholder, "setFrame:", frame);
+		callVoid(placeholder, "setAutoresizingMask:", (unsigned long)(2 | 16)/*NSViewWidthSizable | NSViewHeightSizable*/);
+		callVoid(webview, "addSubview:", placeholder);
+	}
+	void removePlaceholder() {
+		using namespace _objc;
+		if (!placeholder) return;
+		callVoid(placeholder, "removeFromSuperview");
+		callVoid(placeholder, "release");
+		placeholder = nullptr;
+	}
+
 	~Impl() {
 		using namespace _objc;
+		removePlaceholder();
 		if (messageHandler) objc_setAssociatedObject(messageHandler, associatedObjectKey, (id)nullptr, OBJC_ASSOCIATION_ASSIGN);
 		if (schemeHandler) objc_setAssociatedObject(schemeHandler, associatedObjectKey, (id)nullptr, OBJC_ASSOCIATION_ASSIGN);
 		if (webview) {
@@ -236,7 +396,7 @@ struct WebviewGui::Impl {
 bool WebviewGui::supports(Platform p) {
 	return p == Platform::COCOA;
 }
-WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, ResourceGetter getter) {
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, ResourceGetter getter, const Options &options) {
 	if (!supports(platform)) return nullptr;
 	
 	using namespace _objc;
@@ -245,32 +405,36 @@ WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath,
 	id url = callSimple("NSURL", "URLWithString:relativeToURL:", nsString(startPath.c_str()), baseUrl);
 	auto *request = _objc::callSimple("NSMutableURLRequest", "requestWithURL:", url);
 	
-	auto *impl = new Impl(std::move(getter));
+	auto *impl = new Impl(std::move(getter), options);
 	if (!impl->webview) {
 		delete impl;
 		return nullptr;
 	}
+	auto *gui = new WebviewGui(impl);
+	gui->timeline.mark("navigation-start", startPath);
 	callSimple(impl->webview, "loadRequest:", request);
-	return new WebviewGui(impl);
+	return gui;
 }
-WebviewGui * WebviewGui::create(Platform platform, const std::string &startUrl) {
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startUrl, const Options &options) {
 	if (!supports(platform)) return nullptr;
 
 	using namespace _objc;
 	id url = callSimple("NSURL", "URLWithString:", nsString(startUrl.c_str()));
 	if (!url) return nullptr;
 
-	auto *impl = new Impl();
+	auto *impl = new Impl({}, options);
 	if (!impl->webview) {
 		delete impl;
 		return nullptr;
 	}
+	auto *gui = new WebviewGui(impl);
+	gui->timeline.mark("navigation-start", startUrl);
 	auto *request = _objc::callSimple("NSMutableURLRequest", "requestWithURL:", url);
 	callSimple(impl->webview, "loadRequest:", request);
-	return new WebviewGui(impl);
+	return gui;
 }
-WebviewGui * WebviewGui::create(Platform platform, const std::string &startPathOrUrl, const std::string &baseDir) {
-	if (!baseDir.size()) return create(platform, startPathOrUrl);
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPathOrUrl, const std::string &baseDir, const Options &options) {
+	if (!baseDir.size()) return create(platform, startPathOrUrl, options);
 	if (!supports(platform)) return nullptr;
 
 	using namespace _objc;
@@ -282,23 +446,26 @@ WebviewGui * WebviewGui::create(Platform platform, const std::string &startPathO
 	id url = callSimple("NSURL", "URLWithString:relativeToURL:", nsString(startUrlC), baseUrl);
 	if (!url) return nullptr;
 	
-	auto *impl = new Impl();
+	auto *impl = new Impl({}, options);
 	if (!impl->webview) {
 		delete impl;
 		return nullptr;
 	}
 
+	auto *gui = new WebviewGui(impl);
+	gui->timeline.mark("navigation-start", startPathOrUrl);
 	if (callSimple<bool>(url, "isFileURL")) {
 		callSimple(impl->webview, "loadFileURL:allowingReadAccessToURL:", url, baseUrl);
 	} else {
 		auto *request = _objc::callSimple("NSMutableURLRequest", "requestWithURL:", url);
 		callSimple(impl->webview, "loadRequest:", request);
 	}
-	return new WebviewGui(impl);
+	return gui;
 }
 
 WebviewGui::WebviewGui(WebviewGui::Impl *impl) : impl(impl) {
 	impl->main = this;
+	impl->timeline.attach(timeline);
 }
 WebviewGui::~WebviewGui() {
 	delete impl;
@@ -307,20 +474,21 @@ void WebviewGui::attach(void *platformNative) {
 	using namespace _objc;
 	callVoid((id)platformNative, "addSubview:", impl->webview);
 }
-void WebviewGui::send(const unsigned char *bytes, size_t length) {
-	std::string js = "window.dispatchEvent(new MessageEvent('message',{data:Uint8Array.fromBase64('";
-	helpers::encodeBase64(bytes, length, js);
-	js += "').buffer}))";
-
-	using namespace _objc;
-	callSimple(impl->webview, "evaluateJavaScript:completionHandler:", nsString(js.c_str()), (id)nullptr);
-}
 void WebviewGui::setSize(double width, double height) {
 	using namespace _objc;
 	CGRect rect{{0, 0}, {width, height}};
 	callSimple(impl->webview, "setFrame:", rect);
+	impl->width = width;
+	impl->height = height;
+	impl->evaluate(("_WebviewGui_resized(" + std::to_string(width) + "," + std::to_string(height) + ")").c_str());
+}
+
+// The platform runs its own event loop
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	return -1;
 }
-void WebviewGui::setVisible(bool visible) {}
+void WebviewGui::processEvents() {}
 
 } // namespace
 
@@ -1,4 +1,5 @@
 #include "../../helpers.h"
+#include "../runtime-js.h"
 
 #include "choc/platform/choc_Platform.h"
 
@@ -9,11 +10,16 @@
 #	include "choc/memory/choc_Base64.h"
 
 #	include <unordered_map>
-#	include <fstream>
 #	include <memory>
 #	include <iostream>
 #	define LOG_EXPR(expr) std::cout << #expr " = " << (expr) << std::endl;
 
+#	if CHOC_LINUX
+#		include <gtk/gtk.h>
+#		include <gtk/gtkx.h>
+#		include <gdk/gdkx.h>
+#	endif
+
 namespace webview_gui {
 
 #	if CHOC_APPLE
@@ -50,12 +56,112 @@ struct WebviewGui::Impl {
 		id subview = (id)webview->getViewHandle();
 		call<void>(subview, "setFrame:", rect);
 	}
+	void setViewVisible(bool visible) {
+		if (!webview) return;
+		using namespace choc::objc;
+		id subview = (id)webview->getViewHandle();
+		call<void>(subview, "setHidden:", (BOOL)!visible);
+	}
+	// CHOC doesn't give us the data store, so this only tells the page
+	void clearCaches(std::function<void()> cleared) {
+		cleared();
+	}
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		callback({});
+	}
+	void showPlaceholder(const std::vector<unsigned char> &) {}
+	void firstPaint() {}
+	void send(uint32_t channel, const unsigned char *bytes, size_t length);
+	void sendText(const char *text, size_t length);
+	void announceChannel(const std::string &name, uint32_t channel);
+	void setVisible(bool visible, double memoryPressureSeconds);
+	void memoryPressure(std::function<void()> cleared);
 
 	WebviewGui *main = nullptr;
 	std::unique_ptr<choc::ui::WebView> webview;
+	// CHOC takes (and copies) a `std::string`, so outgoing scripts and incoming messages reuse these instead of the scratch arena (`std::to_string()` of a channel fits in the small-string buffer)
+	std::string script, received;
+	bool receiving = false;
+
+	// Milestones from before `main` exists are kept until the `WebviewGui` is constructed
+	PendingTimeline timeline;
 };
 #	else
 struct WebviewGui::Impl {
+#		if CHOC_LINUX
+	~Impl() {
+		// Pending snapshots call back (with nothing) when cancelled, and pending cache clears don't call back at all
+		g_cancellable_cancel(cancellable);
+		g_object_unref(cancellable);
+		// The plug holds a reference to the webview's widget, so destroy that first
+		webview = nullptr;
+		if (plug) gtk_widget_destroy(plug);
+	}
+
+	void init(const choc::ui::WebView::Options &options) {
+		// Plugins don't own the GTK main loop, so the host might not have initialised GTK
+		static bool gtkReady = gtk_init_check(nullptr, nullptr);
+		if (!gtkReady) return;
+		webview = std::unique_ptr<choc::ui::WebView>{
+			new choc::ui::WebView(options)
+		};
+	}
+
+	/* XEmbed: the webview lives in a GtkPlug, whose X11 window is reparented into the host's.  It's inside an overlay, so a placeholder can cover it.
+	The host's window isn't an XEmbed socket, so nothing would send the plug the embedder's half of the protocol, and it would never get keyboard focus.  Instead we send it ourselves when the view is clicked: X input focus, then XEMBED_WINDOW_ACTIVATE and XEMBED_FOCUS_IN.
+	*/
+	GtkWidget *plug = nullptr, *overlay = nullptr;
+	static void sendXEmbed(GtkWidget *plug, long message, long detail=0) {
+		auto *display = GDK_DISPLAY_XDISPLAY(gtk_widget_get_display(plug));
+		auto plugWindow = gdk_x11_window_get_xid(gtk_widget_get_window(plug));
+		XEvent event{};
+		event.xclient.type = ClientMessage;
+		event.xclient.window = plugWindow;
+		event.xclient.message_type = XInternAtom(display, "_XEMBED", False);
+		event.xclient.format = 32;
+		event.xclient.data.l[0] = CurrentTime;
+		event.xclient.data.l[1] = message;
+		event.xclient.data.l[2] = detail;
+		XSendEvent(display, plugWindow, False, NoEventMask, &event);
+	}
+	static gboolean focusOnClick(GtkWidget *widget, GdkEventButton *, gpointer plugPtr) {
+		auto *plug = (GtkWidget *)plugPtr;
+		if (!gtk_widget_get_realized(plug)) return FALSE;
+		auto *display = GDK_DISPLAY_XDISPLAY(gtk_widget_get_display(plug));
+		XSetInputFocus(display, gdk_x11_window_get_xid(gtk_widget_get_window(plug)), RevertToParent, CurrentTime);
+		sendXEmbed(plug, 1/*XEMBED_WINDOW_ACTIVATE*/);
+		sendXEmbed(plug, 4/*XEMBED_FOCUS_IN*/, 0/*XEMBED_FOCUS_CURRENT*/);
+		gtk_widget_grab_focus(widget);
+		XFlush(display);
+		return FALSE; // the webview still gets the click
+	}
+	void attach(void *parent) {
+		if (!webview) return;
+		auto *widget = (GtkWidget *)webview->getViewHandle();
+		if (!plug) {
+			plug = gtk_plug_new(0);
+			overlay = gtk_overlay_new();
+			gtk_container_add(GTK_CONTAINER(overlay), widget);
+			gtk_container_add(GTK_CONTAINER(plug), overlay);
+			g_signal_connect(widget, "button-press-event", G_CALLBACK(focusOnClick), plug);
+			if (!pendingPlaceholder.empty()) showPlaceholder(pendingPlaceholder);
+			pendingPlaceholder.clear();
+		}
+		gtk_widget_realize(plug);
+		auto *display = GDK_DISPLAY_XDISPLAY(gtk_widget_get_display(plug));
+		auto plugWindow = gdk_x11_window_get_xid(gtk_widget_get_window(plug));
+		XReparentWindow(display, plugWindow, (Window)(uintptr_t)parent, 0, 0);
+		gtk_widget_show_all(plug);
+		XMapWindow(display, plugWindow);
+		sendXEmbed(plug, 0/*XEMBED_EMBEDDED_NOTIFY*/, 0);
+		XFlush(display);
+	}
+	void setSize(double width, double height) {
+		if (!webview) return;
+		gtk_widget_set_size_request((GtkWidget *)webview->getViewHandle(), int(width), int(height));
+		if (plug) gtk_window_resize(GTK_WINDOW(plug), int(width), int(height));
+	}
+#		else
 	void init(const choc::ui::WebView::Options &options) {
 		webview = std::unique_ptr<choc::ui::WebView>{
 			new choc::ui::WebView(options)
@@ -69,15 +175,109 @@ struct WebviewGui::Impl {
 		LOG_EXPR(width);
 		LOG_EXPR(height);
 	}
+#		endif
+	void setViewVisible(bool visible) {
+		if (!webview) return;
+#		if CHOC_WINDOWS
+		ShowWindow((HWND)webview->getViewHandle(), visible ? SW_SHOW : SW_HIDE);
+#		else
+		// An unmapped WebKitWebView is treated as hidden, so WebKit stops animation frames and throttles timers
+		gtk_widget_set_visible((GtkWidget *)webview->getViewHandle(), visible);
+#		endif
+	}
+#		if CHOC_LINUX
+	GCancellable *cancellable = g_cancellable_new();
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		if (!webview) return callback({});
+		using Callback = std::function<void(std::vector<unsigned char>)>;
+		webkit_web_view_get_snapshot(WEBKIT_WEB_VIEW(webview->getViewHandle()), WEBKIT_SNAPSHOT_REGION_VISIBLE, WEBKIT_SNAPSHOT_OPTIONS_NONE, cancellable, [](GObject *source, GAsyncResult *result, gpointer userData){
+			std::unique_ptr<Callback> callback{(Callback *)userData};
+			std::vector<unsigned char> png;
+			if (auto *surface = webkit_web_view_get_snapshot_finish(WEBKIT_WEB_VIEW(source), result, nullptr)) {
+				cairo_surface_write_to_png_stream(surface, [](void *closure, const unsigned char *data, unsigned int length){
+					auto &png = *(std::vector<unsigned char> *)closure;
+					png.insert(png.end(), data, data + length);
+					return CAIRO_STATUS_SUCCESS;
+				}, &png);
+				cairo_surface_destroy(surface);
+			}
+			(*callback)(std::move(png));
+		}, new Callback(std::move(callback)));
+	}
+
+	GtkWidget *placeholder = nullptr;
+	std::vector<unsigned char> pendingPlaceholder; // until there's an overlay to put it in
+	bool painted = false;
+	void showPlaceholder(const std::vector<unsigned char> &png) {
+		if (painted) return;
+		if (!overlay) {
+			pendingPlaceholder = png;
+			return;
+		}
+		removePlaceholder();
+		auto *loader = gdk_pixbuf_loader_new();
+		bool loaded = gdk_pixbuf_loader_write(loader, png.data(), png.size(), nullptr);
+		loaded = gdk_pixbuf_loader_close(loader, nullptr) && loaded;
+		if (auto *pixbuf = loaded ? gdk_pixbuf_loader_get_pixbuf(loader) : nullptr) {
+			placeholder = gtk_image_new_from_pixbuf(pixbuf);
+			gtk_overlay_add_overlay(GTK_OVERLAY(overlay), placeholder);
+			gtk_widget_show(placeholder);
+		}
+		g_object_unref(loader);
+	}
+	void removePlaceholder() {
+		if (placeholder) gtk_widget_destroy(placeholder);
+		placeholder = nullptr;
+	}
+	void firstPaint() {
+		painted = true;
+		pendingPlaceholder.clear();
+		removePlaceholder();
+	}
+#		else
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		callback({});
+	}
+	void showPlaceholder(const std::vector<unsigned char> &) {}
+	void firstPaint() {}
+#		endif
+	void clearCaches(std::function<void()> cleared) {
+#		if CHOC_LINUX
+		if (!webview) return;
+		using Callback = std::function<void()>;
+		auto *dataManager = webkit_web_view_get_website_data_manager(WEBKIT_WEB_VIEW(webview->getViewHandle()));
+		webkit_website_data_manager_clear(dataManager, WEBKIT_WEBSITE_DATA_MEMORY_CACHE, 0, cancellable, [](GObject *source, GAsyncResult *result, gpointer userData){
+			std::unique_ptr<Callback> cleared{(Callback *)userData};
+			// Fails (without touching us) if we were destroyed first
+			if (webkit_website_data_manager_clear_finish(WEBKIT_WEBSITE_DATA_MANAGER(source), result, nullptr)) (*cleared)();
+		}, new Callback(std::move(cleared)));
+#		else
+		// WebView2's memory target isn't in CHOC's trimmed-down header, so on Windows this only tells the page
+		cleared();
+#		endif
+	}
+	void send(uint32_t channel, const unsigned char *bytes, size_t length);
+	void sendText(const char *text, size_t length);
+	void announceChannel(const std::string &name, uint32_t channel);
+	void setVisible(bool visible, double memoryPressureSeconds);
+	void memoryPressure(std::function<void()> cleared);
 
 	WebviewGui *main = nullptr;
 	std::unique_ptr<choc::ui::WebView> webview;
+	// CHOC takes (and copies) a `std::string`, so outgoing scripts and incoming messages reuse these instead of the scratch arena (`std::to_string()` of a channel fits in the small-string buffer)
+	std::string script, received;
+	bool receiving = false;
+
+	// Milestones from before `main` exists are kept until the `WebviewGui` is constructed
+	PendingTimeline timeline;
 };
 #	endif
 
-WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &startPath, WebviewGui::ResourceGetter getter) {
+// CHOC creates the view with its own data store (on Linux, WebKit's default context, which is already persistent), so `Options::dataDirectory` (macOS-only) can't be applied
+WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &startPath, WebviewGui::ResourceGetter getter, const Options &) {
 	if (!supports(p)) return nullptr;
 
+	auto constructStart = Timeline::Clock::now();
 	auto *impl = new WebviewGui::Impl();
 	
 	choc::ui::WebView::Options options;
@@ -90,11 +290,18 @@ WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &start
 	options.customSchemeURI = "choc://choc.choc/";
 #	endif
 	auto startUri = options.customSchemeURI + startPath;
-   	options.fetchResource = [getter](const std::string &path) {
+   	options.fetchResource = [getter, impl](const std::string &path) {
 		using ChocResource = choc::ui::WebView::Options::Resource;
 		std::optional<ChocResource> chocResource;
 		Resource resource;
-		if (getter(path.c_str(), resource)) {
+		bool found = impl->main && impl->main->telemetryResource(path.c_str(), resource);
+		if (!found) {
+			auto getterStart = Timeline::Clock::now();
+			found = getter(path.c_str(), resource);
+			impl->timeline.add("resource", getterStart, path);
+			if (impl->main) impl->main->resourceRequested(path.c_str(), found, resource, getterStart);
+		}
+		if (found) {
 			chocResource.emplace();
 			chocResource->data = std::move(resource.bytes);
 			if (resource.mediaType.size()) {
@@ -106,88 +313,64 @@ WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &start
 		return chocResource;
 	};
 	options.webviewIsReady = [startUri, impl](choc::ui::WebView &wv){
-		wv.addInitScript(R"jsCode(
-			if (!Uint8Array.prototype.toBase64) {
-				Uint8Array.prototype.toBase64 = function() {
-					let binaryString = "";
-					for (var i = 0; i < this.length; i++) {
-						binaryString += String.fromCharCode(this[i]);
-					}
-					return btoa(binaryString);
-				};
-			}
-			if (!Uint8Array.fromBase64) {
-				Uint8Array.fromBase64 = b64 => {
-					let binaryString = atob(b64);
-					let array = new Uint8Array(b64.length);
-					for (let i=0; i < array.length; ++i) {
-						array[i] = binaryString.charCodeAt(i);
-					}
-					return array;
-				};
-			}
-			window.addEventListener('message', e=>{
-				if (e.source == window) {
-					e.stopImmediatePropagation();
-					_WebviewGui_receive64(new Uint8Array(e.data).toBase64());
-				}
-			}, {capture: true});
-			function _WebviewGui_send64(b64){
-				window.dispatchEvent(new MessageEvent('message', {data: Uint8Array.fromBase64(b64).buffer}));
-			}
-		)jsCode");
+		wv.addInitScript(_js::runtime);
 
 		wv.bind("_WebviewGui_receive64", [impl](const choc::value::ValueView& args){
 			auto *gui = impl->main;
-			if (gui && gui->receive && args.isArray() && args.size() == 1) {
+			if (gui && args.isArray() && args.size() == 1) {
+				// Needs null-termination - a nested receive (e.g. from a handler running the event loop) gets its own copy
 				auto base64 = args[0].getString();
-				std::vector<unsigned char> bytes;
-				choc::base64::decodeToContainer(bytes, base64);
-				gui->receive(bytes.data(), bytes.size());
+				std::string nested;
+				auto &text = impl->receiving ? nested : impl->received;
+				bool outermost = !impl->receiving;
+				impl->receiving = true;
+				text.assign(base64.data(), base64.size());
+				gui->receive64(text.c_str());
+				if (outermost) impl->receiving = false;
+			}
+			return choc::value::Value{true};
+		});
+		wv.bind("_WebviewGui_event", [impl](const choc::value::ValueView& args){
+			if (args.isArray() && args.size() >= 1) {
+				std::string detail;
+				if (args.size() >= 2 && args[1].isString()) detail = std::string(args[1].getString());
+				std::string name{args[0].getString()};
+				if (name == "first-paint") impl->firstPaint();
+				impl->timeline.add(name, Timeline::Clock::now(), detail);
 			}
 			return choc::value::Value{true};
 		});
 
+		impl->timeline.add("navigation-start", Timeline::Clock::now(), startUri);
 		wv.navigate(startUri);
 	};
 
+	auto webviewStart = Timeline::Clock::now();
 	impl->init(options);
-	if (!impl->webview->loadedOK()) {
+	impl->timeline.add("webview-create", webviewStart);
+	if (!impl->webview || !impl->webview->loadedOK()) {
 		delete impl;
 		return nullptr;
 	}
+	impl->timeline.add("impl-construct", constructStart);
 
 	return new WebviewGui(impl);
 }
 
-WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &startUrl) {
-	return create(p, startUrl, [](const char *path, Resource &resource){
+WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &startUrl, const Options &options) {
+	return create(p, startUrl, [](const char * /*path*/, Resource & /*resource*/){
 		// No custom resources - the start URL needs to be absolute
 		return false;
-	});
+	}, options);
 }
 
-WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &startPath, const std::string &baseDir) {
-	return create(p, startPath, [baseDir](const char *path, Resource &resource){
-		// Read resources from disk
-		auto fullPath = baseDir + path;
-#	if CHOC_WINDOWS
-		for (size_t i = baseDir.size(); i < fullPath.size(); ++i) {
-			if (fullPath[i] == '/') fullPath[i] = '\\';
-		}
-#	endif
-		std::ifstream fileStream{fullPath, std::ios::binary | std::ios::ate};
-		if (!fileStream) return false;
-		size_t length = fileStream.tellg();
-		resource.bytes.resize(length);
-		fileStream.seekg(0);
-		fileStream.read((char *)resource.bytes.data(), length);
-		return bool(fileStream);
-	});
+WebviewGui * WebviewGui::create(WebviewGui::Platform p, const std::string &startPath, const std::string &baseDir, const Options &options) {
+	return create(p, startPath, fileGetter(baseDir), options);
 }
 
 WebviewGui::WebviewGui(WebviewGui::Impl *impl) : impl(impl) {
 	impl->main = this;
+	impl->timeline.attach(timeline);
 }
 WebviewGui::~WebviewGui() {
 	delete impl;
@@ -199,14 +382,83 @@ bool WebviewGui::supports(WebviewGui::Platform p) {
 void WebviewGui::attach(void *platformNative) {
 	impl->attach(platformNative);
 }
-void WebviewGui::send(const unsigned char *bytes, size_t length) {
-	auto base64 = choc::base64::encodeToString(bytes, length);
-	impl->webview->evaluateJavascript("_WebviewGui_send64(\"" + base64 + "\");");
+inline void WebviewGui::Impl::send(uint32_t channel, const unsigned char *bytes, size_t length) {
+	auto &js = script;
+	js.clear();
+	js.reserve(32 + (length + 2)/3*4);
+	js += "_WebviewGui_send64(\"";
+	helpers::encodeBase64(bytes, length, js);
+	js += "\",";
+	js += std::to_string(channel);
+	js += ");";
+	webview->evaluateJavascript(js);
+}
+inline void WebviewGui::Impl::sendText(const char *text, size_t length) {
+	auto &js = script;
+	js.clear();
+	js += "_WebviewGui_sendText(";
+	helpers::appendJsonString(js, text, length);
+	js += ");";
+	webview->evaluateJavascript(js);
+}
+inline void WebviewGui::Impl::announceChannel(const std::string &name, uint32_t channel) {
+	auto &js = script;
+	js.clear();
+	js += "_WebviewGui_channelId(";
+	helpers::appendJsonString(js, name.data(), name.size());
+	js += ',';
+	js += std::to_string(channel);
+	js += ");";
+	webview->evaluateJavascript(js);
+}
+inline void WebviewGui::Impl::setVisible(bool visible, double memoryPressureSeconds) {
+	setViewVisible(visible);
+	if (webview) webview->evaluateJavascript("_WebviewGui_setVisible(" + std::string(visible ? "true" : "false") + "," + std::to_string(memoryPressureSeconds) + ");");
+}
+inline void WebviewGui::Impl::memoryPressure(std::function<void()> cleared) {
+	clearCaches(std::move(cleared));
+	if (webview) webview->evaluateJavascript("_WebviewGui_memoryPressure();");
 }
 void WebviewGui::setSize(double width, double height) {
 	impl->setSize(width, height);
+	if (impl->webview) {
+		impl->webview->evaluateJavascript("_WebviewGui_resized(" + std::to_string(width) + "," + std::to_string(height) + ");");
+	}
+}
+
+#	if CHOC_LINUX
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	auto *context = g_main_context_default();
+	if (!g_main_context_acquire(context)) return -1; // someone else is running the loop
+	gint priority = 0, timeout = -1;
+	g_main_context_prepare(context, &priority);
+	std::vector<GPollFD> pollFds(16);
+	int count;
+	while ((count = g_main_context_query(context, priority, &timeout, pollFds.data(), int(pollFds.size()))) > int(pollFds.size())) {
+		pollFds.resize(count);
+	}
+	g_main_context_release(context);
+	for (int i = 0; i < count; ++i) {
+		auto &p = pollFds[i];
+		fds.push_back({p.fd, bool(p.events&G_IO_IN), bool(p.events&G_IO_OUT), bool(p.events&(G_IO_ERR|G_IO_HUP))});
+	}
+	return timeout;
+}
+void WebviewGui::processEvents() {
+	// Bounded, so we can't starve the host's loop
+	for (int i = 0; i < 100; ++i) {
+		if (!g_main_context_iteration(nullptr, false)) break;
+	}
+}
+#	else
+// The platform runs its own event loop
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	return -1;
 }
-void WebviewGui::setVisible(bool visible) {}
+void WebviewGui::processEvents() {}
+#	endif
 
 //-------------
 
@@ -0,0 +1,585 @@
+#pragma once
+
+#include "../../helpers.h"
+#include "../../headless-js.h"
+#include "../runtime-js.h"
+
+#if defined(__has_include) && __has_include("choc/javascript/choc_javascript_QuickJS.h")
+#	include "choc/javascript/choc_javascript_QuickJS.h"
+#	include "choc/text/choc_JSON.h"
+#else
+#	include "./choc/javascript/choc_javascript_QuickJS.h"
+#	include "./choc/text/choc_JSON.h"
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+namespace webview_gui {
+
+namespace _js {
+
+/* Stands in for the browser, before `runtime` runs.  Provided natively:
+	_WebviewGui_headlessNow() - milliseconds since the page started
+	_WebviewGui_headlessConsole(level, text)
+	_WebviewGui_headlessFetch(path) - "{mediaType}\n{base64}", or `undefined` if not found
+*/
+static constexpr const char *headlessShim = R"JS(
+	(()=>{
+		let g = globalThis;
+		g.window = g.self = g.parent = g.top = g;
+		g.performance = {now: ()=>_WebviewGui_headlessNow()};
+
+		let report = (level, args)=>{
+			_WebviewGui_headlessConsole(level, args.map(a=>{
+				if (typeof a == 'string') return a;
+				if (a instanceof Error) return a.stack ? a.message + '\n' + a.stack : String(a);
+				try {
+					return JSON.stringify(a);
+				} catch (e) {
+					return String(a);
+				}
+			}).join(' '));
+		};
+		g.console = {};
+		['log', 'info', 'warn', 'error', 'debug'].forEach(level=>{
+			g.console[level] = (...args)=>report(level, args);
+		});
+		// Like a browser, exceptions from callbacks are reported and don't stop anything else
+		let guard = (fn, thisArg, ...args)=>{
+			try {
+				fn.apply(thisArg, args);
+			} catch (e) {
+				report('error', ['Uncaught', e]);
+			}
+		};
+
+		class Event {
+			constructor(type, init) {
+				init = init || {};
+				this.type = String(type);
+				this.bubbles = !!init.bubbles;
+				this.cancelable = !!init.cancelable;
+				this.defaultPrevented = false;
+				this.target = this.currentTarget = null;
+				this.timeStamp = performance.now();
+				this._stopped = false;
+			}
+			preventDefault() {
+				if (this.cancelable) this.defaultPrevented = true;
+			}
+			stopPropagation() {}
+			stopImmediatePropagation() {
+				this._stopped = true;
+			}
+		}
+		class CustomEvent extends Event {
+			constructor(type, init) {
+				super(type, init);
+				this.detail = (init && 'detail' in init) ? init.detail : null;
+			}
+		}
+		class MessageEvent extends Event {
+			constructor(type, init) {
+				super(type, init);
+				init = init || {};
+				this.data = ('data' in init) ? init.data : null;
+				this.origin = init.origin || '';
+				this.source = init.source || null;
+				this.ports = init.ports || [];
+			}
+		}
+
+		// There's no tree, so capturing listeners just run first
+		let allListeners = new WeakMap();
+		class EventTarget {
+			addEventListener(type, callback, options) {
+				if (!callback) return;
+				let capture = (typeof options == 'object') ? !!(options && options.capture) : !!options;
+				let once = (typeof options == 'object') && !!(options && options.once);
+				let byType = allListeners.get(this);
+				if (!byType) allListeners.set(this, byType = {});
+				let list = byType[type] = byType[type] || [];
+				if (list.some(l=>l.callback === callback && l.capture == capture)) return;
+				list.push({callback: callback, capture: capture, once: once});
+			}
+			removeEventListener(type, callback, options) {
+				let capture = (typeof options == 'object') ? !!(options && options.capture) : !!options;
+				let byType = allListeners.get(this), list = byType && byType[type];
+				if (!list) return;
+				let index = list.findIndex(l=>l.callback === callback && l.capture == capture);
+				if (index >= 0) {
+					list[index].removed = true;
+					list.splice(index, 1);
+				}
+			}
+			dispatchEvent(event) {
+				event.target = event.currentTarget = this;
+				let byType = allListeners.get(this), list = (byType && byType[event.type] || []).slice();
+				for (let capture of [true, false]) {
+					for (let listener of list) {
+						if (event._stopped) break;
+						if (listener.capture != capture || listener.removed) continue;
+						if (listener.once) this.removeEventListener(event.type, listener.callback, {capture: capture});
+						let callback = listener.callback;
+						if (typeof callback == 'function') {
+							guard(callback, this, event);
+						} else if (callback && typeof callback.handleEvent == 'function') {
+							guard(callback.handleEvent, callback, event);
+						}
+					}
+				}
+				let handler = this['on' + event.type];
+				if (!event._stopped && typeof handler == 'function') guard(handler, this, event);
+				return !event.defaultPrevented;
+			}
+		}
+		g.Event = Event;
+		g.CustomEvent = CustomEvent;
+		g.MessageEvent = MessageEvent;
+		g.EventTarget = EventTarget;
+
+		g.document = new EventTarget();
+		document.readyState = 'loading';
+		document.hidden = false;
+		document.visibilityState = 'visible';
+		['addEventListener', 'removeEventListener', 'dispatchEvent'].forEach(name=>{
+			g[name] = EventTarget.prototype[name];
+		});
+		// Synchronous, unlike a browser - so a message posted from the page reaches C++ before `postMessage()` returns
+		g.postMessage = data=>{
+			window.dispatchEvent(new MessageEvent('message', {data: data, source: window, origin: location.origin}));
+		};
+
+		let timers = new Map(), nextTimerId = 1;
+		let frames = [], nextFrameId = 1, nextFrameTime = 0;
+		let addTimer = (fn, ms, args, repeat)=>{
+			let id = nextTimerId++;
+			ms = Math.max(0, Number(ms) || 0);
+			timers.set(id, {fn: fn, args: args, due: performance.now() + ms, interval: repeat ? Math.max(1, ms) : -1});
+			return id;
+		};
+		g.setTimeout = (fn, ms, ...args)=>addTimer(fn, ms, args, false);
+		g.setInterval = (fn, ms, ...args)=>addTimer(fn, ms, args, true);
+		g.clearTimeout = g.clearInterval = id=>{
+			timers.delete(id);
+		};
+		g.requestAnimationFrame = fn=>{
+			frames.push({id: nextFrameId, fn: fn});
+			return nextFrameId++;
+		};
+		g.cancelAnimationFrame = id=>{
+			frames = frames.filter(f=>f.id != id);
+		};
+		g.queueMicrotask = fn=>{
+			Promise.resolve().then(()=>guard(fn));
+		};
+
+		const chars = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
+		g.btoa = s=>{
+			s = String(s);
+			let out = '';
+			for (let i = 0; i < s.length; i += 3) {
+				let a = s.charCodeAt(i), b = (i + 1 < s.length) ? s.charCodeAt(i + 1) : 0, c = (i + 2 < s.length) ? s.charCodeAt(i + 2) : 0;
+				if ((a|b|c) > 255) throw new Error('btoa(): character out of range');
+				let n = (a << 16)|(b << 8)|c;
+				out += chars[n >> 18] + chars[(n >> 12)&63] + ((i + 1 < s.length) ? chars[(n >> 6)&63] : '=') + ((i + 2 < s.length) ? chars[n&63] : '=');
+			}
+			return out;
+		};
+		g.atob = s=>{
+			s = String(s).replace(/[\s=]+/g, '');
+			let out = '', bits = 0, value = 0;
+			for (let i = 0; i < s.length; ++i) {
+				let index = chars.indexOf(s[i]);
+				if (index < 0) throw new Error('atob(): invalid character');
+				value = ((value << 6)|index)&0xFFFFFF;
+				bits += 6;
+				if (bits >= 8) {
+					bits -= 8;
+					out += String.fromCharCode((value >> bits)&255);
+				}
+			}
+			return out;
+		};
+
+		class TextEncoder {
+			get encoding() {
+				return 'utf-8';
+			}
+			encode(s) {
+				s = String(s === undefined ? '' : s);
+				let bytes = [];
+				for (let i = 0; i < s.length; ++i) {
+					let c = s.codePointAt(i);
+					if (c > 0xFFFF) ++i;
+					if (c >= 0xD800 && c < 0xE000) c = 0xFFFD; // unpaired surrogate
+					if (c < 0x80) {
+						bytes.push(c);
+					} else if (c < 0x800) {
+						bytes.push(0xC0|(c >> 6), 0x80|(c&63));
+					} else if (c < 0x10000) {
+						bytes.push(0xE0|(c >> 12), 0x80|((c >> 6)&63), 0x80|(c&63));
+					} else {
+						bytes.push(0xF0|(c >> 18), 0x80|((c >> 12)&63), 0x80|((c >> 6)&63), 0x80|(c&63));
+					}
+				}
+				return new Uint8Array(bytes);
+			}
+		}
+		class TextDecoder {
+			get encoding() {
+				return 'utf-8';
+			}
+			decode(data) {
+				if (!data) return '';
+				let bytes = ArrayBuffer.isView(data) ? new Uint8Array(data.buffer, data.byteOffset, data.byteLength) : new Uint8Array(data);
+				let out = '';
+				for (let i = 0; i < bytes.length;) {
+					let b = bytes[i], c = 0xFFFD, extra = (b >= 0xF0) ? 3 : (b >= 0xE0) ? 2 : (b >= 0xC0) ? 1 : 0;
+					if (b < 0x80) {
+						c = b;
+					} else if (b >= 0xC0 && b < 0xF8 && i + extra < bytes.length) {
+						c = b&(0x3F >> extra);
+						for (let j = 1; j <= extra; ++j) c = (c << 6)|(bytes[i + j]&63);
+					}
+					i += 1 + extra;
+					out += String.fromCodePoint(c > 0x10FFFF ? 0xFFFD : c);
+				}
+				return out;
+			}
+		}
+		g.TextEncoder = TextEncoder;
+		g.TextDecoder = TextDecoder;
+
+		let origin = 'webview-gui://headless';
+		g.location = {origin: origin, href: origin + '/', pathname: '/'};
+		class Response {
+			constructor(bytes, status, mediaType) {
+				this._bytes = bytes;
+				this.status = status;
+				this.ok = (status >= 200 && status < 300);
+				this.headers = {get: name=>(String(name).toLowerCase() == 'content-type') ? mediaType : null};
+			}
+			arrayBuffer() {
+				return Promise.resolve(this._bytes.slice().buffer);
+			}
+			text() {
+				return Promise.resolve(new TextDecoder().decode(this._bytes));
+			}
+			json() {
+				return this.text().then(JSON.parse);
+			}
+		}
+		g.fetch = input=>new Promise((resolve, reject)=>{
+			let url = String((input && input.url) || input);
+			if (url.startsWith(origin)) url = url.substr(origin.length);
+			if (/^[a-z][a-z0-9+.-]*:/i.test(url)) return reject(new TypeError('fetch(): only the page\'s own resources are available'));
+			if (url[0] != '/') url = location.pathname.replace(/[^\/]*$/, '') + url;
+			let result = _WebviewGui_headlessFetch(url);
+			if (typeof result != 'string') return resolve(new Response(new Uint8Array(0), 404, null));
+			let split = result.indexOf('\n'), binary = atob(result.substr(split + 1));
+			let bytes = new Uint8Array(binary.length);
+			for (let i = 0; i < bytes.length; ++i) bytes[i] = binary.charCodeAt(i);
+			resolve(new Response(bytes, 200, result.substr(0, split)));
+		});
+
+		// Used from C++
+		g._WebviewGui_headless = {
+			visible: true,
+			frameInterval: 1000/60,
+			start(path) {
+				location.pathname = path;
+				location.href = origin + path;
+			},
+			contentLoaded() {
+				document.readyState = 'interactive';
+				document.dispatchEvent(new Event('DOMContentLoaded'));
+				document.readyState = 'complete';
+				window.dispatchEvent(new Event('load'));
+			},
+			setVisible(visible) {
+				this.visible = visible;
+				document.hidden = !visible;
+				document.visibilityState = visible ? 'visible' : 'hidden';
+				document.dispatchEvent(new Event('visibilitychange'));
+			},
+			runTimers() {
+				let now = performance.now();
+				// Only what was due when we started, so a zero-length interval can't loop forever
+				let due = [];
+				timers.forEach((timer, id)=>{
+					if (timer.due <= now) due.push([id, timer]);
+				});
+				due.sort((a, b)=>a[1].due - b[1].due);
+				due.forEach(([id, timer])=>{
+					if (timers.get(id) !== timer) return; // cleared by an earlier one
+					if (timer.interval < 0) {
+						timers.delete(id);
+					} else {
+						timer.due = now + timer.interval;
+					}
+					if (typeof timer.fn == 'function') guard(timer.fn, window, ...timer.args);
+				});
+				// Like a real webview, hidden pages don't get animation frames
+				if (this.visible && frames.length && now >= nextFrameTime) {
+					let callbacks = frames;
+					frames = [];
+					nextFrameTime = now + this.frameInterval;
+					callbacks.forEach(f=>guard(f.fn, window, now));
+				}
+				return this.nextTimer();
+			},
+			nextTimer() {
+				let next = -1;
+				timers.forEach(timer=>{
+					if (next < 0 || timer.due < next) next = timer.due;
+				});
+				if (this.visible && frames.length && (next < 0 || nextFrameTime < next)) next = nextFrameTime;
+				return (next < 0) ? -1 : Math.max(0, next - performance.now());
+			}
+		};
+	})();
+)JS";
+
+} // namespace
+
+struct WebviewGui::Impl : public headless_js::Page {
+	WebviewGui *main = nullptr;
+	ResourceGetter getter;
+	headless_js::Options options = headless_js::options;
+	choc::javascript::Context context;
+	Timeline::Clock::time_point startTime = Timeline::Clock::now();
+	void *parent = nullptr;
+
+	// For the static `processEvents()`
+	static std::vector<Impl *> & instances() {
+		static std::vector<Impl *> list;
+		return list;
+	}
+
+	// Milestones from before `main` exists are kept until the `WebviewGui` is constructed
+	PendingTimeline timeline;
+
+	Impl(ResourceGetter g) : getter(std::move(g)), context(choc::javascript::createQuickJSContext()) {
+		instances().push_back(this);
+		context.registerFunction("_WebviewGui_receive64", [this](choc::javascript::ArgumentList args){
+			if (main) main->receive64(args.get<std::string>(0).c_str());
+			return choc::value::Value{};
+		});
+		context.registerFunction("_WebviewGui_event", [this](choc::javascript::ArgumentList args){
+			timeline.add(args.get<std::string>(0), Timeline::Clock::now(), args.get<std::string>(1));
+			return choc::value::Value{};
+		});
+		context.registerFunction("_WebviewGui_headlessNow", [this](choc::javascript::ArgumentList){
+			return choc::value::createFloat64(std::chrono::duration<double, std::milli>(Timeline::Clock::now() - startTime).count());
+		});
+		context.registerFunction("_WebviewGui_headlessConsole", [this](choc::javascript::ArgumentList args){
+			if (options.console) options.console(args.get<std::string>(0), args.get<std::string>(1));
+			return choc::value::Value{};
+		});
+		context.registerFunction("_WebviewGui_headlessFetch", [this](choc::javascript::ArgumentList args){
+			Resource resource;
+			if (!fetch(args.get<std::string>(0).c_str(), resource)) return choc::value::Value{};
+			std::string result = resource.mediaType + "\n";
+			helpers::encodeBase64(resource.bytes.data(), resource.bytes.size(), result);
+			return choc::value::createString(result);
+		});
+		run(_js::headlessShim);
+		run("_WebviewGui_headless.frameInterval = " + std::to_string(1000/std::max(options.framesPerSecond, 1.0)) + ";");
+		run(_js::runtime);
+		for (auto &script : options.initScripts) run(script);
+	}
+	~Impl() {
+		auto &list = instances();
+		list.erase(std::remove(list.begin(), list.end(), this), list.end());
+	}
+
+	// Runs a script for its side-effects, without converting the result
+	bool run(const std::string &code) {
+		return evaluate(code + "\n;void 0");
+	}
+
+	bool fetch(const char *path, Resource &resource) {
+		if (main && main->telemetryResource(path, resource)) return true;
+		if (!getter) return false;
+		resource.mediaType = helpers::guessMediaType(path);
+		auto getterStart = Timeline::Clock::now();
+		bool found = getter(path, resource);
+		timeline.add("resource", getterStart, path);
+		if (main) main->resourceRequested(path, found, resource, getterStart);
+		return found;
+	}
+
+	// Runs the start page's `<script>`s in order - `type="module"` scripts are run as classic ones, so they can't use `import`
+	void navigate(const std::string &start) {
+		timeline.add("navigation-start", Timeline::Clock::now(), start);
+		std::string startPath = (start.empty() || start[0] != '/') ? "/" + start : start;
+		run("_WebviewGui_headless.start(" + jsonString(startPath) + ");");
+		Resource page;
+		if (getter && fetch(startPath.c_str(), page)) {
+			std::string source(page.bytes.begin(), page.bytes.end());
+			if (page.mediaType.find("javascript") != std::string::npos) {
+				run(source);
+			} else {
+				runScripts(source, startPath.substr(0, startPath.rfind('/') + 1));
+			}
+		}
+		run("_WebviewGui_headless.contentLoaded();");
+		if (options.load) options.load(*this);
+	}
+	void runScripts(const std::string &html, const std::string &directory) {
+		std::string lower = html;
+		for (auto &c : lower) c = char(std::tolower((unsigned char)c));
+		size_t pos = 0;
+		while ((pos = lower.find("<script", pos)) != std::string::npos) {
+			auto tagEnd = lower.find('>', pos);
+			if (tagEnd == std::string::npos) break;
+			auto end = lower.find("</script", tagEnd);
+			if (end == std::string::npos) end = html.size();
+			auto src = attribute(html.substr(pos, tagEnd - pos), lower.substr(pos, tagEnd - pos), "src");
+			if (!src.empty()) {
+				if (src[0] != '/') src = directory + src;
+				Resource script;
+				if (fetch(src.c_str(), script)) run(std::string(script.bytes.begin(), script.bytes.end()));
+			} else {
+				run(html.substr(tagEnd + 1, end - tagEnd - 1));
+			}
+			pos = end;
+		}
+	}
+	static std::string attribute(const std::string &tag, const std::string &lowerTag, const std::string &name) {
+		auto pos = lowerTag.find(" " + name + "=");
+		if (pos == std::string::npos) return {};
+		pos += name.size() + 2;
+		char quote = tag[pos];
+		if (quote != '"' && quote != '\'') {
+			auto end = tag.find_first_of(" \t\r\n/", pos);
+			return tag.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+		}
+		auto end = tag.find(quote, pos + 1);
+		return (end == std::string::npos) ? std::string() : tag.substr(pos + 1, end - pos - 1);
+	}
+	static std::string jsonString(const std::string &text) {
+		std::string json;
+		helpers::appendJsonString(json, text.data(), text.size());
+		return json;
+	}
+
+	void send(uint32_t channel, const unsigned char *bytes, size_t length) {
+		// CHOC takes a `std::string`, so this can't use the scratch arena - but it's built in one reserved allocation
+		std::string js;
+		js.reserve(32 + (length + 2)/3*4);
+		js += "_WebviewGui_send64(\"";
+		helpers::encodeBase64(bytes, length, js);
+		js += "\",";
+		js += std::to_string(channel);
+		js += ");void 0";
+		evaluate(js);
+	}
+	void sendText(const char *text, size_t length) {
+		std::string js = "_WebviewGui_sendText(";
+		helpers::appendJsonString(js, text, length);
+		js += ");void 0";
+		evaluate(js);
+	}
+	void announceChannel(const std::string &name, uint32_t channel) {
+		run("_WebviewGui_channelId(" + jsonString(name) + "," + std::to_string(channel) + ");");
+	}
+	void setVisible(bool visible, double memoryPressureSeconds) {
+		std::string flag = visible ? "true" : "false";
+		run("_WebviewGui_headless.setVisible(" + flag + ");_WebviewGui_setVisible(" + flag + "," + std::to_string(memoryPressureSeconds) + ");");
+	}
+	void memoryPressure(std::function<void()> cleared) {
+		run("_WebviewGui_memoryPressure();");
+		cleared();
+	}
+	// Nothing is rendered
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		callback({});
+	}
+	void showPlaceholder(const std::vector<unsigned char> &) {}
+
+	//---- headless_js::Page ----
+	bool evaluate(const std::string &code, std::string *resultJson=nullptr) override {
+		try {
+			auto result = context.evaluateExpression(code);
+			context.pumpMessageLoop();
+			if (resultJson) *resultJson = result.isVoid() ? std::string() : choc::json::toString(result);
+			return true;
+		} catch (const std::exception &e) {
+			if (options.console) options.console("error", e.what());
+			return false;
+		}
+	}
+	double runTimers() override {
+		std::string next;
+		if (!evaluate("_WebviewGui_headless.runTimers()", &next)) return -1;
+		return std::strtod(next.c_str(), nullptr);
+	}
+	double nextTimer() {
+		std::string next;
+		if (!evaluate("_WebviewGui_headless.nextTimer()", &next)) return -1;
+		return std::strtod(next.c_str(), nullptr);
+	}
+};
+
+bool WebviewGui::supports(Platform p) {
+	return p != Platform::NONE;
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, ResourceGetter getter, const Options &) {
+	// No persistent data to keep
+	if (!supports(platform)) return nullptr;
+	auto constructStart = Timeline::Clock::now();
+	auto *impl = new Impl(std::move(getter));
+	impl->timeline.add("webview-create", constructStart);
+	impl->timeline.add("impl-construct", constructStart);
+	auto *gui = new WebviewGui(impl);
+	impl->navigate(startPath);
+	return gui;
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startUrl, const Options &options) {
+	// No custom resources - the start URL is absolute, so there's nothing to fetch (but the runtime still starts)
+	return create(platform, startUrl, ResourceGetter{}, options);
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, const std::string &baseDir, const Options &options) {
+	return create(platform, startPath, fileGetter(baseDir), options);
+}
+
+WebviewGui::WebviewGui(WebviewGui::Impl *impl) : impl(impl) {
+	impl->main = this;
+	impl->timeline.attach(timeline);
+}
+WebviewGui::~WebviewGui() {
+	delete impl;
+}
+void WebviewGui::attach(void *platformNative) {
+	impl->parent = platformNative;
+}
+void WebviewGui::setSize(double width, double height) {
+	impl->run("_WebviewGui_resized(" + std::to_string(width) + "," + std::to_string(height) + ");");
+}
+
+// No file descriptors, just the timeout until the next timer (or animation frame) in any page
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	double timeout = -1;
+	for (auto *impl : Impl::instances()) {
+		double next = impl->nextTimer();
+		if (next >= 0 && (timeout < 0 || next < timeout)) timeout = next;
+	}
+	return (timeout < 0) ? -1 : int(std::ceil(timeout));
+}
+void WebviewGui::processEvents() {
+	// Timers can destroy instances (through a handler), so this works from a copy
+	auto list = Impl::instances();
+	for (auto *impl : list) {
+		auto &current = Impl::instances();
+		if (std::find(current.begin(), current.end(), impl) != current.end()) impl->runTimers();
+	}
+}
+
+} // namespace
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "../../helpers.h"
+#include "../../loopback.h"
+
+#include <cstdlib>
+#include <unordered_map>
+
+namespace webview_gui {
+
+struct WebviewGui::Impl : public loopback::Page {
+	WebviewGui *main = nullptr;
+	ResourceGetter getter;
+	loopback::Script script = loopback::script;
+	void *parent = nullptr;
+	double pageWidth = 0, pageHeight = 0;
+	bool pageVisible = true;
+	double pageMemoryPressureSeconds = -1;
+	std::unordered_map<std::string, uint32_t> pageChannels;
+
+	// Milestones from before `main` exists are kept until the `WebviewGui` is constructed
+	PendingTimeline timeline;
+
+	Impl(ResourceGetter g={}) : getter(std::move(g)) {}
+
+	void navigate(const std::string &start) {
+		timeline.add("navigation-start", Timeline::Clock::now(), start);
+		if (getter) {
+			Resource resource;
+			if (!fetch(start.c_str(), resource)) return;
+		}
+		timeline.add("dom-content-loaded", Timeline::Clock::now());
+		if (script.load) script.load(*this);
+	}
+
+	// Evaluates the JS which a real backend would send, i.e. `_WebviewGui_send64('...', channel)`
+	void evaluate(const char *js) {
+		auto *start = std::strchr(js, '\'');
+		auto *end = start ? std::strchr(start + 1, '\'') : nullptr;
+		if (!end) return;
+		std::vector<unsigned char, helpers::ArenaAllocator<unsigned char>> decoded{helpers::ArenaAllocator<unsigned char>(&main->scratch)};
+		decoded.reserve(size_t(end - start)/4*3 + 3);
+		helpers::decodeBase64(start + 1, decoded);
+		auto channel = uint32_t(std::strtoul(end + 2, nullptr, 10));
+		if (!channel) {
+			if (script.message) script.message(*this, decoded.data(), decoded.size());
+		} else if (script.channelMessage) {
+			script.channelMessage(*this, channel, decoded.data(), decoded.size());
+		}
+	}
+	// Like the platform backends, scripts are built in the per-instance scratch arena
+	helpers::ArenaString scratchString() {
+		return helpers::ArenaString{helpers::ArenaAllocator<char>(&main->scratch)};
+	}
+
+	void send(uint32_t channel, const unsigned char *bytes, size_t length) {
+		auto js = scratchString();
+		js += "_WebviewGui_send64('";
+		helpers::encodeBase64(bytes, length, js);
+		js += "',";
+		js += std::to_string(channel).c_str();
+		js += ")";
+		evaluate(js.c_str());
+	}
+	// Builds the JS a real backend would evaluate, and then parses the string literal back out of it
+	void sendText(const char *text, size_t length) {
+		auto js = scratchString();
+		js += "_WebviewGui_sendText(";
+		helpers::appendJsonString(js, text, length);
+		js += ")";
+		if (script.textMessage) script.textMessage(*this, parseJsonString(js.c_str() + std::strlen("_WebviewGui_sendText(")));
+	}
+	static std::string parseJsonString(const char *json) {
+		std::string text;
+		if (*json != '"') return text;
+		for (++json; *json && *json != '"'; ++json) {
+			if (*json != '\\') {
+				text.push_back(*json);
+				continue;
+			}
+			++json;
+			if (*json == 'u') {
+				auto code = unsigned(std::strtoul(std::string(json + 1, 4).c_str(), nullptr, 16));
+				json += 4;
+				// Only control characters and U+2028/U+2029 are escaped
+				if (code < 0x80) {
+					text.push_back(char(code));
+				} else {
+					text.push_back(char(0xE0 | (code >> 12)));
+					text.push_back(char(0x80 | ((code >> 6)&0x3F)));
+					text.push_back(char(0x80 | (code&0x3F)));
+				}
+			} else {
+				text.push_back(*json);
+			}
+		}
+		return text;
+	}
+	// Equivalent to `_WebviewGui_channelId()`
+	void announceChannel(const std::string &name, uint32_t channel) {
+		pageChannels[name] = channel;
+	}
+	void setVisible(bool visible, double memoryPressureSeconds) {
+		pageVisible = visible;
+		// There are no timers here, so the script decides when (or whether) to call `Page::hiddenTimeout()`
+		pageMemoryPressureSeconds = visible ? -1 : memoryPressureSeconds;
+	}
+	void memoryPressure(std::function<void()> cleared) {
+		if (script.memoryPressure) script.memoryPressure(*this);
+		cleared();
+	}
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		callback(script.snapshot ? script.snapshot(*this) : std::vector<unsigned char>{});
+	}
+	// The page loads synchronously in `create()`, so it's always painted before there's anything to cover
+	void showPlaceholder(const std::vector<unsigned char> &) {}
+
+	// Equivalent to the `_WebviewGui_receive64()` binding
+	void receive64(const char *base64) {
+		if (main) main->receive64(base64);
+	}
+
+	//---- loopback::Page ----
+	void post(const unsigned char *bytes, size_t length) override {
+		if (!main) return;
+		ScratchScope scope{*main};
+		auto base64 = scratchString();
+		helpers::encodeBase64(bytes, length, base64);
+		receive64(base64.c_str());
+	}
+	void postText(const std::string &text) override {
+		receive64(("'" + text).c_str());
+	}
+	uint32_t channel(const std::string &name) override {
+		auto iter = pageChannels.find(name);
+		if (iter != pageChannels.end()) return iter->second;
+		receive64(("?" + name).c_str()); // answered synchronously by `announceChannel()`
+		return pageChannels[name];
+	}
+	void post(uint32_t channel, const unsigned char *bytes, size_t length) override {
+		if (!main) return;
+		ScratchScope scope{*main};
+		auto base64 = scratchString();
+		base64 += std::to_string(channel).c_str();
+		base64 += ":";
+		helpers::encodeBase64(bytes, length, base64);
+		receive64(base64.c_str());
+	}
+	bool fetch(const char *path, Resource &resource) override {
+		if (main && main->telemetryResource(path, resource)) return true;
+		if (!getter) return false;
+		resource.mediaType = helpers::guessMediaType(path);
+		auto getterStart = Timeline::Clock::now();
+		bool found = getter(path, resource);
+		timeline.add("resource", getterStart, path);
+		if (main) main->resourceRequested(path, found, resource, getterStart);
+		return found;
+	}
+	double width() const override {
+		return pageWidth;
+	}
+	double height() const override {
+		return pageHeight;
+	}
+	bool visible() const override {
+		return pageVisible;
+	}
+	double memoryPressureSeconds() const override {
+		return pageMemoryPressureSeconds;
+	}
+	void hiddenTimeout() override {
+		if (pageMemoryPressureSeconds >= 0) receive64("!memory-pressure");
+	}
+};
+
+bool WebviewGui::supports(Platform p) {
+	return p != Platform::NONE;
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, ResourceGetter getter, const Options &) {
+	// No persistent data to keep
+	if (!supports(platform)) return nullptr;
+	auto constructStart = Timeline::Clock::now();
+	auto *impl = new Impl(std::move(getter));
+	impl->timeline.add("webview-create", constructStart);
+	impl->timeline.add("impl-construct", constructStart);
+	auto *gui = new WebviewGui(impl);
+	impl->navigate(startPath);
+	return gui;
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startUrl, const Options &options) {
+	// No custom resources - the start URL is absolute, so there's nothing to fetch
+	return create(platform, startUrl, ResourceGetter{}, options);
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, const std::string &baseDir, const Options &options) {
+	return create(platform, startPath, fileGetter(baseDir), options);
+}
+
+WebviewGui::WebviewGui(WebviewGui::Impl *impl) : impl(impl) {
+	impl->main = this;
+	impl->timeline.attach(timeline);
+}
+WebviewGui::~WebviewGui() {
+	delete impl;
+}
+void WebviewGui::attach(void *platformNative) {
+	impl->parent = platformNative;
+}
+void WebviewGui::setSize(double width, double height) {
+	impl->pageWidth = width;
+	impl->pageHeight = height;
+	if (impl->script.resize) impl->script.resize(*impl, width, height);
+}
+
+// Everything happens synchronously, so there are no events to process
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	return -1;
+}
+void WebviewGui::processEvents() {}
+
+} // namespace
@@ -3,26 +3,41 @@
 namespace webview_gui {
 
 // No native webview - do absolutely nothing
-struct WebviewGui::Impl {};
+struct WebviewGui::Impl {
+	void send(uint32_t, const unsigned char *, size_t) {}
+	void sendText(const char *, size_t) {}
+	void announceChannel(const std::string &, uint32_t) {}
+	void setVisible(bool, double) {}
+	void memoryPressure(std::function<void()> cleared) {
+		cleared();
+	}
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		callback({});
+	}
+	void showPlaceholder(const std::vector<unsigned char> &) {}
+};
 bool WebviewGui::supports(Platform) {
 	return false;
 }
-WebviewGui * WebviewGui::create(Platform, const std::string &) {
+WebviewGui * WebviewGui::create(Platform, const std::string &, const Options &) {
 	return nullptr;
 }
-WebviewGui * WebviewGui::create(Platform, const std::string &, const std::string &) {
+WebviewGui * WebviewGui::create(Platform, const std::string &, const std::string &, const Options &) {
 	return nullptr;
 }
-WebviewGui * WebviewGui::create(Platform, const std::string &, ResourceGetter) {
+WebviewGui * WebviewGui::create(Platform, const std::string &, ResourceGetter, const Options &) {
 	return nullptr;
 }
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	return -1;
+}
+void WebviewGui::processEvents() {}
 
 // None of these should ever be called, because no instances can ever be created
 WebviewGui::WebviewGui(WebviewGui::Impl *) {}
 WebviewGui::~WebviewGui() {}
 void WebviewGui::attach(void *) {}
-void WebviewGui::send(const unsigned char *, size_t) {}
 void WebviewGui::setSize(double, double) {}
-void WebviewGui::setVisible(bool) {}
 
 } // namespace
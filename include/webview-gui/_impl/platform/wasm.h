@@ -0,0 +1,200 @@
+#pragma once
+
+#include "../../helpers.h"
+
+#include <algorithm>
+
+/* WebAssembly backend (e.g. WCLAP): there's no native webview, so the page lives wherever the embedding JS puts it - usually a parent frame, or a `MessagePort` to one.
+
+The embedder provides the "webview-gui" import module and calls the `webview_gui_*` exports - see `wasm.mjs`, which does both.  Binary messages never touch base64 or strings: outgoing ones are copied once from linear memory into an `ArrayBuffer` which is transferred to the page, and incoming ones are copied straight into a reusable region of linear memory.
+
+It's wasm32-only: pointers and `size_t` cross into JS as plain numbers, and the fetched-resource descriptor holds 32-bit pointers.
+*/
+#define WEBVIEW_GUI_WASM_IMPORT(name) __attribute__((import_module("webview-gui"), import_name(#name)))
+#define WEBVIEW_GUI_WASM_EXPORT(name) __attribute__((used, export_name(#name)))
+
+namespace webview_gui {
+
+namespace _wasm {
+	extern "C" {
+		// Opens the page, returning a handle for the other imports
+		WEBVIEW_GUI_WASM_IMPORT(create) uint32_t webview_gui_wasm_create(void *receiver, const char *startPath, size_t startPathLength);
+		WEBVIEW_GUI_WASM_IMPORT(destroy) void webview_gui_wasm_destroy(uint32_t handle);
+		WEBVIEW_GUI_WASM_IMPORT(send) void webview_gui_wasm_send(uint32_t handle, uint32_t channel, const unsigned char *bytes, size_t length);
+		WEBVIEW_GUI_WASM_IMPORT(sendText) void webview_gui_wasm_send_text(uint32_t handle, const char *text, size_t length);
+		WEBVIEW_GUI_WASM_IMPORT(announceChannel) void webview_gui_wasm_announce_channel(uint32_t handle, const char *name, size_t nameLength, uint32_t channel);
+		WEBVIEW_GUI_WASM_IMPORT(setVisible) void webview_gui_wasm_set_visible(uint32_t handle, int visible, double memoryPressureSeconds);
+		WEBVIEW_GUI_WASM_IMPORT(setSize) void webview_gui_wasm_set_size(uint32_t handle, double width, double height);
+		WEBVIEW_GUI_WASM_IMPORT(memoryPressure) void webview_gui_wasm_memory_pressure(uint32_t handle);
+	}
+
+	// Passed to `webview_gui_receive()`
+	enum ReceiveKind : uint32_t {
+		BINARY = 0, TEXT = 1, CHANNEL_REQUEST = 2, MEMORY_PRESSURE = 3, MEMORY_PRESSURE_DONE = 4
+	};
+
+	// What the exports call (`WebviewGui::Impl` is private, so JS holds one of these instead)
+	struct Receiver {
+		virtual ~Receiver() {}
+		virtual unsigned char * receiveBuffer(size_t length) = 0;
+		virtual void receive(uint32_t kind, uint32_t channel, size_t length) = 0;
+		virtual const uint32_t * fetch(size_t pathLength) = 0;
+	};
+}
+
+struct WebviewGui::Impl : public _wasm::Receiver {
+	WebviewGui *main = nullptr;
+	ResourceGetter getter;
+	uint32_t handle = 0;
+	void *parent = nullptr;
+
+	// Incoming messages are written here by JS - one spare byte either side, so text can be passed to `receive64()` with its prefix and null terminator in place
+	std::vector<unsigned char> receiveRegion;
+	// The most recent `webview_gui_fetch()`, kept until the next one: bytes pointer, length, media-type pointer, length
+	Resource fetched;
+	uint32_t fetchedDescriptor[4] = {};
+	// From `memoryPressure()`, called once the page has handled the event (and dropped if we're destroyed first)
+	std::vector<std::function<void()>> pressureCleared;
+
+	// Milestones from before `main` exists are kept until the `WebviewGui` is constructed
+	PendingTimeline timeline;
+
+	Impl(ResourceGetter g) : getter(std::move(g)) {}
+	~Impl() {
+		if (handle) _wasm::webview_gui_wasm_destroy(handle);
+	}
+
+	void navigate(const std::string &start) {
+		timeline.add("navigation-start", Timeline::Clock::now(), start);
+		handle = _wasm::webview_gui_wasm_create(static_cast<_wasm::Receiver *>(this), start.data(), start.size());
+	}
+
+	//---- _wasm::Receiver ----
+	unsigned char * receiveBuffer(size_t length) override {
+		if (receiveRegion.size() < length + 2) receiveRegion.resize(std::max(length + 2, receiveRegion.size()*2));
+		return receiveRegion.data() + 1;
+	}
+	void receive(uint32_t kind, uint32_t channel, size_t length) override {
+		if (!main || receiveRegion.size() < length + 2) return;
+		auto *bytes = receiveRegion.data();
+		if (kind == _wasm::BINARY) return main->receiveBinary(channel, bytes + 1, length);
+		if (kind == _wasm::MEMORY_PRESSURE) return main->receive64("!memory-pressure");
+		if (kind == _wasm::MEMORY_PRESSURE_DONE) {
+			// Every pending request is covered, since the page handles them in order
+			auto callbacks = std::move(pressureCleared);
+			pressureCleared.clear();
+			for (auto &cleared : callbacks) cleared();
+			return;
+		}
+		bytes[0] = (kind == _wasm::TEXT) ? '\'' : '?';
+		bytes[length + 1] = 0;
+		main->receive64((const char *)bytes);
+	}
+	const uint32_t * fetch(size_t pathLength) override {
+		if (receiveRegion.size() < pathLength + 2) return nullptr;
+		receiveRegion[pathLength + 1] = 0;
+		std::string path{(const char *)receiveRegion.data() + 1};
+		fetched = Resource{};
+		if (main && main->telemetryResource(path.c_str(), fetched)) return describeFetched();
+		if (!getter) return nullptr;
+		fetched.mediaType = helpers::guessMediaType(path.c_str());
+		auto getterStart = Timeline::Clock::now();
+		bool found = getter(path.c_str(), fetched);
+		timeline.add("resource", getterStart, path);
+		if (main) main->resourceRequested(path.c_str(), found, fetched, getterStart);
+		return found ? describeFetched() : nullptr;
+	}
+	const uint32_t * describeFetched() {
+		fetchedDescriptor[0] = uint32_t(uintptr_t(fetched.bytes.data()));
+		fetchedDescriptor[1] = uint32_t(fetched.bytes.size());
+		fetchedDescriptor[2] = uint32_t(uintptr_t(fetched.mediaType.data()));
+		fetchedDescriptor[3] = uint32_t(fetched.mediaType.size());
+		return fetchedDescriptor;
+	}
+
+	void send(uint32_t channel, const unsigned char *bytes, size_t length) {
+		_wasm::webview_gui_wasm_send(handle, channel, bytes, length);
+	}
+	void sendText(const char *text, size_t length) {
+		_wasm::webview_gui_wasm_send_text(handle, text, length);
+	}
+	void announceChannel(const std::string &name, uint32_t channel) {
+		_wasm::webview_gui_wasm_announce_channel(handle, name.data(), name.size(), channel);
+	}
+	void setVisible(bool visible, double memoryPressureSeconds) {
+		_wasm::webview_gui_wasm_set_visible(handle, visible, memoryPressureSeconds);
+	}
+	// There are no caches on this side, so it's done once the page has handled the event
+	void memoryPressure(std::function<void()> cleared) {
+		pressureCleared.push_back(std::move(cleared));
+		_wasm::webview_gui_wasm_memory_pressure(handle);
+	}
+	// Nothing is rendered on this side
+	void captureSnapshot(std::function<void(std::vector<unsigned char>)> callback) {
+		callback({});
+	}
+	void showPlaceholder(const std::vector<unsigned char> &) {}
+};
+
+extern "C" {
+	// Space for an incoming message of `length` bytes, reused between messages (JS should re-view memory afterwards, in case it grew)
+	WEBVIEW_GUI_WASM_EXPORT(webview_gui_receive_buffer) inline unsigned char * webview_gui_receive_buffer(_wasm::Receiver *receiver, size_t length) {
+		return receiver->receiveBuffer(length);
+	}
+	// Delivers what was written to the receive buffer - `kind` is a `_wasm::ReceiveKind`
+	WEBVIEW_GUI_WASM_EXPORT(webview_gui_receive) inline void webview_gui_receive(_wasm::Receiver *receiver, uint32_t kind, uint32_t channel, size_t length) {
+		receiver->receive(kind, channel, length);
+	}
+	// Requests the path written to the receive buffer through the `ResourceGetter`, returning null or four u32s: bytes pointer, length, media-type pointer, length
+	WEBVIEW_GUI_WASM_EXPORT(webview_gui_fetch) inline const uint32_t * webview_gui_fetch(_wasm::Receiver *receiver, size_t pathLength) {
+		return receiver->fetch(pathLength);
+	}
+}
+
+// There's no native view, so any platform will do
+bool WebviewGui::supports(Platform p) {
+	return p != Platform::NONE;
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, ResourceGetter getter, const Options &) {
+	// The page (and so its caching) belongs to the embedder
+	if (!supports(platform)) return nullptr;
+	auto constructStart = Timeline::Clock::now();
+	auto *impl = new Impl(std::move(getter));
+	impl->timeline.add("impl-construct", constructStart);
+	auto *gui = new WebviewGui(impl);
+	impl->navigate(startPath);
+	return gui;
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startUrl, const Options &options) {
+	return create(platform, startUrl, ResourceGetter{}, options);
+}
+WebviewGui * WebviewGui::create(Platform platform, const std::string &startPath, const std::string &baseDir, const Options &options) {
+	// From the WASI filesystem
+	return create(platform, startPath, fileGetter(baseDir), options);
+}
+
+WebviewGui::WebviewGui(WebviewGui::Impl *impl) : impl(impl) {
+	impl->main = this;
+	impl->timeline.attach(timeline);
+}
+WebviewGui::~WebviewGui() {
+	delete impl;
+}
+void WebviewGui::attach(void *platformNative) {
+	impl->parent = platformNative;
+}
+void WebviewGui::setSize(double width, double height) {
+	_wasm::webview_gui_wasm_set_size(impl->handle, width, height);
+}
+
+// JS runs the event loop
+int WebviewGui::getEventFds(std::vector<EventFd> &fds) {
+	fds.clear();
+	return -1;
+}
+void WebviewGui::processEvents() {}
+
+} // namespace
+
+#undef WEBVIEW_GUI_WASM_IMPORT
+#undef WEBVIEW_GUI_WASM_EXPORT
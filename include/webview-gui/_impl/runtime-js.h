@@ -0,0 +1,245 @@
+#pragma once
+
+namespace webview_gui { namespace _js {
+
+/* Injected into every page at document start, shared by the platform implementations.
+
+The platform must provide these before this runs (as native bindings or JS shims):
+	_WebviewGui_receive64(base64) - passes bytes to `WebviewGui::receive()`
+	_WebviewGui_event(name, detail) - reports page lifecycle events (for `WebviewGui::timeline`)
+
+The page can route incoming messages to a worker instead of `window` with `webviewGui.useWorker(script)` - see `_WebviewGui_workerRuntime()` below.
+
+The C++ side then sends bytes by calling `_WebviewGui_send64(base64, channel)` (or text with `_WebviewGui_sendText(string)`), tells the page channel IDs with `_WebviewGui_channelId(name, id)`, reports native resizes with `_WebviewGui_resized(width, height)`, visibility changes with `_WebviewGui_setVisible(visible, memoryPressureSeconds)`, and memory pressure with `_WebviewGui_memoryPressure()`.
+*/
+static constexpr const char *runtime = R"JS(
+	if (!Uint8Array.prototype.toBase64) {
+		Uint8Array.prototype.toBase64 = function() {
+			let binaryString = "";
+			for (var i = 0; i < this.length; i++) {
+				binaryString += String.fromCharCode(this[i]);
+			}
+			return btoa(binaryString);
+		};
+	}
+	if (!Uint8Array.fromBase64) {
+		Uint8Array.fromBase64 = b64 => {
+			let binaryString = atob(b64);
+			let array = new Uint8Array(binaryString.length);
+			for (let i=0; i < array.length; ++i) {
+				array[i] = binaryString.charCodeAt(i);
+			}
+			return array;
+		};
+	}
+	window.addEventListener('message', e=>{
+		if (e.source == window) { // this happens if we attempt to send using `window.parent` from the main frame
+			e.stopImmediatePropagation();
+			let data = e.data;
+			if (typeof data == 'string') return _WebviewGui_receive64("'" + data);
+			data = ArrayBuffer.isView(data) ? new Uint8Array(data.buffer, data.byteOffset, data.byteLength) : new Uint8Array(data);
+			_WebviewGui_receive64(data.toBase64());
+		}
+	}, {capture: true});
+	// Set by `webviewGui.useWorker()`, which routes plain messages, text, and the worker's channels there
+	let _WebviewGui_worker = null;
+	function _WebviewGui_send64(b64, channel) {
+		let target = channel ? _WebviewGui_channels.byId[channel] : (_WebviewGui_worker || window);
+		// Dropped if the page hasn't asked for the channel (e.g. after a reload)
+		if (!target) return;
+		let buffer = Uint8Array.fromBase64(b64).buffer;
+		if (target == _WebviewGui_worker) {
+			// Transferred, so the worker gets it without a copy
+			target.postMessage(channel ? {webviewGui: 'message', id: channel, data: buffer} : buffer, [buffer]);
+		} else {
+			target.dispatchEvent(new MessageEvent('message', {data: buffer}));
+		}
+	}
+	function _WebviewGui_sendText(text) {
+		if (_WebviewGui_worker) return _WebviewGui_worker.postMessage(text);
+		window.dispatchEvent(new MessageEvent('message', {data: text}));
+	}
+	// Named channels: the name is sent once to ask for an ID, and after that messages are prefixed with "{id}:"
+	class _WebviewGui_Channel extends EventTarget {
+		constructor(name) {
+			super();
+			this.name = name;
+			this.id = 0;
+			this.queue = [];
+		}
+		send(data) {
+			data = ArrayBuffer.isView(data) ? new Uint8Array(data.buffer, data.byteOffset, data.byteLength) : new Uint8Array(data);
+			if (this.id) {
+				_WebviewGui_receive64(this.id + ':' + data.toBase64());
+			} else {
+				this.queue.push(data.slice());
+			}
+		}
+	}
+	var _WebviewGui_channels = {byName: {}, byId: []};
+	function _WebviewGui_channelId(name, id) {
+		let channel = _WebviewGui_channels.byName[name];
+		if (!channel) channel = _WebviewGui_channels.byName[name] = new _WebviewGui_Channel(name);
+		channel.id = id;
+		_WebviewGui_channels.byId[id] = channel;
+		channel.queue.forEach(data=>channel.send(data));
+		channel.queue = [];
+		if (name in _WebviewGui_workerChannels) _WebviewGui_workerChannel(name, id);
+	}
+	// Latency probes from `WebviewGui::probeLatency()` are echoed straight back
+	let _WebviewGui_probe = _WebviewGui_channels.byName['webview-gui/probe'] = new _WebviewGui_Channel('webview-gui/probe');
+	_WebviewGui_probe.addEventListener('message', e=>_WebviewGui_probe.send(e.data));
+	window.webviewGui = window.webviewGui || {};
+	// Fetches the latest telemetry frame (see `WebviewGui::serveTelemetry()`) once per animation frame, with at most one request in flight.  Returns a function which stops it.
+	webviewGui.telemetry = (name, callback)=>{
+		let running = true, counter = 0;
+		let url = '/_webview-gui/telemetry/' + name + '?';
+		let next = ()=>requestAnimationFrame(()=>{
+			if (!running) return;
+			fetch(url + (counter++)).then(r=>r.ok ? r.arrayBuffer() : null).then(buffer=>{
+				if (running && buffer && buffer.byteLength) callback(buffer);
+			}).catch(()=>{}).finally(()=>{
+				if (running) next();
+			});
+		});
+		next();
+		return ()=>{running = false};
+	};
+	webviewGui.channel = name=>{
+		name = String(name);
+		let channel = _WebviewGui_channels.byName[name];
+		if (!channel) {
+			channel = _WebviewGui_channels.byName[name] = new _WebviewGui_Channel(name);
+			_WebviewGui_receive64('?' + name);
+		}
+		return channel;
+	};
+	/* Runs in the worker (as source, ahead of the worker's own script), with the same protocol as `wasm.mjs`: plain messages are `ArrayBuffer`s or strings both ways, so the worker just uses `postMessage()` and `message` events.  Everything else has a `webviewGui` field, and is handled here:
+		let meters = webviewGui.channel('meters'); // as in the page
+	and `webview-gui-visibility`, `webview-gui-resize` and `webview-gui-memory-pressure` events are dispatched on `self`.
+	*/
+	function _WebviewGui_workerRuntime() {
+		let toBuffer = data=>(data instanceof ArrayBuffer) ? data : new Uint8Array(data.buffer, data.byteOffset, data.byteLength).slice().buffer;
+		class Channel extends EventTarget {
+			constructor(name) {
+				super();
+				this.name = name;
+				this.id = 0;
+				this.queue = [];
+			}
+			// Transfers `ArrayBuffer`s, so don't use them afterwards
+			send(data) {
+				let buffer = toBuffer(data);
+				if (this.id) {
+					postMessage({webviewGui: 'message', id: this.id, data: buffer}, [buffer]);
+				} else {
+					this.queue.push(buffer);
+				}
+			}
+		}
+		let byName = {}, byId = [];
+		self.webviewGui = {
+			channel: name=>{
+				name = String(name);
+				if (!byName[name]) {
+					byName[name] = new Channel(name);
+					postMessage({webviewGui: 'channel', name: name});
+				}
+				return byName[name];
+			}
+		};
+		self.addEventListener('message', e=>{
+			let data = e.data;
+			if (!data || typeof data != 'object' || !data.webviewGui) return;
+			e.stopImmediatePropagation();
+			if (data.webviewGui == 'message') {
+				let channel = byId[data.id];
+				if (channel) channel.dispatchEvent(new MessageEvent('message', {data: data.data}));
+			} else if (data.webviewGui == 'channel') {
+				let channel = byName[data.name] = byName[data.name] || new Channel(data.name);
+				channel.id = data.id;
+				byId[data.id] = channel;
+				channel.queue.forEach(buffer=>channel.send(buffer));
+				channel.queue = [];
+			} else if (data.webviewGui == 'visibility') {
+				self.dispatchEvent(new CustomEvent('webview-gui-visibility', {detail: {visible: data.visible}}));
+			} else if (data.webviewGui == 'resize') {
+				self.dispatchEvent(new CustomEvent('webview-gui-resize', {detail: {width: data.width, height: data.height}}));
+			} else if (data.webviewGui == 'memory-pressure') {
+				self.dispatchEvent(new Event('webview-gui-memory-pressure'));
+			}
+		}, {capture: true});
+	}
+	// Channels the worker has asked for, by name (the ID is 0 until it's known)
+	let _WebviewGui_workerChannels = {};
+	function _WebviewGui_workerChannel(name, id) {
+		_WebviewGui_workerChannels[name] = id;
+		_WebviewGui_channels.byId[id] = _WebviewGui_worker;
+		_WebviewGui_worker.postMessage({webviewGui: 'channel', name: name, id: id});
+	}
+	/* Starts a worker (a classic script, relative to the page) and routes incoming messages to it instead of `window`, so decoding and handling large payloads doesn't compete with rendering and input.  Buffers are decoded here, and transferred.  Whatever the worker posts is relayed back to C++, as if the page had posted it.
+	Channels belong to whichever side asked for them (the worker, once it asks).  Returns the `Worker` (the same one if called again), or `null` where workers aren't available.
+	*/
+	webviewGui.useWorker = script=>{
+		if (_WebviewGui_worker || typeof Worker == 'undefined') return _WebviewGui_worker;
+		// A blob, so the worker runtime is in place before the script runs
+		let source = '(' + _WebviewGui_workerRuntime + ')();\nimportScripts(' + JSON.stringify(new URL(script, location.href).href) + ');';
+		let worker = _WebviewGui_worker = new Worker(URL.createObjectURL(new Blob([source], {type: 'text/javascript'})));
+		let bytes = data=>ArrayBuffer.isView(data) ? new Uint8Array(data.buffer, data.byteOffset, data.byteLength) : new Uint8Array(data);
+		worker.addEventListener('message', e=>{
+			let data = e.data;
+			if (typeof data == 'string') return _WebviewGui_receive64("'" + data);
+			if (data instanceof ArrayBuffer || ArrayBuffer.isView(data)) return _WebviewGui_receive64(bytes(data).toBase64());
+			if (!data || typeof data != 'object') return;
+			if (data.webviewGui == 'message' && data.id) {
+				_WebviewGui_receive64((data.id >>> 0) + ':' + bytes(data.data).toBase64());
+			} else if (data.webviewGui == 'channel') {
+				let name = String(data.name);
+				let channel = _WebviewGui_channels.byName[name];
+				if (channel && channel.id) return _WebviewGui_workerChannel(name, channel.id);
+				_WebviewGui_workerChannels[name] = 0;
+				if (!channel) webviewGui.channel(name);
+			}
+		});
+		return worker;
+	};
+	// Called after each native resize (which the CLAP helper coalesces to one per frame), so heavy pages can debounce relayout
+	function _WebviewGui_resized(width, height) {
+		if (_WebviewGui_worker) _WebviewGui_worker.postMessage({webviewGui: 'resize', width: width, height: height});
+		window.dispatchEvent(new CustomEvent('webview-gui-resize', {detail: {width: width, height: height}}));
+	}
+	// The native view is also hidden, which makes the platform suspend animation frames and throttle timers - this lets the page pause anything else (e.g. meters)
+	let _WebviewGui_pressureTimer = null;
+	function _WebviewGui_setVisible(visible, memoryPressureSeconds) {
+		clearTimeout(_WebviewGui_pressureTimer);
+		// Once hidden for long enough, ask C++ to call `WebviewGui::memoryPressure()`
+		if (!visible && memoryPressureSeconds >= 0) {
+			_WebviewGui_pressureTimer = setTimeout(()=>_WebviewGui_receive64('!memory-pressure'), memoryPressureSeconds*1000);
+		}
+		if (_WebviewGui_worker) _WebviewGui_worker.postMessage({webviewGui: 'visibility', visible: visible});
+		window.dispatchEvent(new CustomEvent('webview-gui-visibility', {detail: {visible: visible}}));
+	}
+	// The page should drop anything it can rebuild (decoded images, cached layouts, pooled buffers)
+	function _WebviewGui_memoryPressure() {
+		if (_WebviewGui_worker) _WebviewGui_worker.postMessage({webviewGui: 'memory-pressure'});
+		window.dispatchEvent(new Event('webview-gui-memory-pressure'));
+	}
+	document.addEventListener('DOMContentLoaded', e=>{
+		_WebviewGui_event('dom-content-loaded', String(performance.now()));
+		let paintReported = false;
+		let firstPaint = time=>{
+			if (!paintReported) _WebviewGui_event('first-paint', String(time));
+			paintReported = true;
+		};
+		// Use paint timing where the platform reports it, otherwise the frame after the next one
+		if (window.PerformanceObserver && (PerformanceObserver.supportedEntryTypes || []).includes('paint')) {
+			new PerformanceObserver(list=>{
+				list.getEntries().forEach(entry=>firstPaint(entry.startTime));
+			}).observe({type: 'paint', buffered: true});
+		} else {
+			requestAnimationFrame(()=>requestAnimationFrame(()=>firstPaint(performance.now())));
+		}
+	});
+)JS";
+
+}} // namespace
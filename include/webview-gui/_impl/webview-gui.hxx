@@ -1,11 +1,18 @@
 #pragma once
 
-#if __APPLE__ && (!defined(TARGET_OS_IPHONE) || !TARGET_OS_IPHONE)
+#ifdef WEBVIEW_GUI_HEADLESS_JS
+#	include "./platform/headless-js.h"
+#elif defined(WEBVIEW_GUI_LOOPBACK)
+#	include "./platform/loopback.h"
+#elif __APPLE__ && (!defined(TARGET_OS_IPHONE) || !TARGET_OS_IPHONE)
 #	include "./platform/apple-osx.h"
-#elif defined(__EMSCRIPTEN__) || defined(__wasm__) || defined(__wasm32__) || defined(__wasm64__)
-#	include "./platform/not-supported.h"
+// Only wasm32: the imports and `wasm.mjs` pass pointers and sizes as 32-bit numbers, so wasm64 gets the not-supported backend
+#elif (defined(__EMSCRIPTEN__) || defined(__wasm__) || defined(__wasm32__)) && !defined(__wasm64__)
+#	include "./platform/wasm.h"
 #elif defined(__has_include) && (__has_include("choc/gui/choc_WebView.h") ||  __has_include("./platform/choc/gui/choc_WebView.h"))
 #	include "./platform/choc.h"
 #else
 #	include "./platform/not-supported.h"
 #endif
+
+#include "./common.hxx"
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "./webview-gui.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace webview_gui {
+
+// Framing policies for `BasicWebviewGui`: messages of any length, decoded into a reused buffer
+struct VariableFrames {
+	static constexpr size_t frameSize = 0;
+};
+// Messages of exactly `size` bytes, decoded onto the stack (anything else is dropped)
+template<size_t size>
+struct FixedFrames {
+	static_assert(size > 0, "use VariableFrames for messages of any length");
+	static constexpr size_t frameSize = size;
+};
+
+/* `WebviewGui` with the receive handler and framing as template parameters, instead of a `std::function`.
+
+Plain (channel 0) messages are decoded by code compiled for this `Handler` and `Framing`, with the handler inlined into it - the only indirect call is the one into that function from the platform's (type-erased) callback.  Channels, text and everything else work as usual, through the underlying `WebviewGui`:
+
+	auto gui = BasicWebviewGui<MyHandler, FixedFrames<16>>::create(MyHandler{...}, WebviewGui::COCOA, "index.html", baseDir);
+	if (gui) gui->attach(parent);
+
+For queueing, the handler can be a push into your own queue (or set `receiveQueue` and use `WebviewGui` instead, which decodes straight into the queue's memory).
+*/
+template<class Handler, class Framing=VariableFrames>
+struct BasicWebviewGui {
+	Handler handler;
+
+	// Arguments after the handler are the same as `WebviewGui::create()` - returns null if that fails
+	template<class... Args>
+	static std::unique_ptr<BasicWebviewGui> create(Handler handler, Args &&...args) {
+		WebviewGui::UniquePtr gui{WebviewGui::create(std::forward<Args>(args)...)};
+		if (!gui) return nullptr;
+		return std::unique_ptr<BasicWebviewGui>{new BasicWebviewGui(std::move(handler), std::move(gui))};
+	}
+	~BasicWebviewGui() {
+		gui->plainReceiver = {};
+	}
+	// We're registered with the `WebviewGui` by address
+	BasicWebviewGui(const BasicWebviewGui &other) = delete;
+
+	WebviewGui * operator->() {
+		return gui.get();
+	}
+	WebviewGui & operator*() {
+		return *gui;
+	}
+	WebviewGui & webview() {
+		return *gui;
+	}
+private:
+	WebviewGui::UniquePtr gui;
+	// Reused for `VariableFrames`, unless a handler sends something which is received synchronously (e.g. the loopback backend)
+	std::vector<unsigned char> buffer;
+	bool receiving = false;
+
+	BasicWebviewGui(Handler handler, WebviewGui::UniquePtr gui) : handler(std::move(handler)), gui(std::move(gui)) {
+		this->gui->plainReceiver = {this, &receive64, &receiveBinary};
+	}
+
+	void deliver(const unsigned char *bytes, size_t length, Metrics::Clock::time_point decodeStart) {
+		gui->markFirstReceive();
+		gui->metrics.received(length, decodeStart);
+		if (gui->recorder) gui->recorder->record(Recorder::Type::RECEIVE, 0, bytes, length);
+		handler(bytes, length);
+	}
+	static void receive64(void *context, const char *base64) {
+		auto &self = *(BasicWebviewGui *)context;
+		auto decodeStart = Metrics::now();
+		if constexpr (Framing::frameSize > 0) {
+			if (helpers::decodedBase64Length(base64) != Framing::frameSize) return;
+			unsigned char frame[Framing::frameSize];
+			helpers::decodeBase64(base64, frame);
+			self.deliver(frame, Framing::frameSize, decodeStart);
+		} else {
+			std::vector<unsigned char> nestedBuffer;
+			auto &binary = self.receiving ? nestedBuffer : self.buffer;
+			bool outermost = !self.receiving;
+			self.receiving = true;
+			binary.clear();
+			helpers::decodeBase64(base64, binary);
+			self.deliver(binary.data(), binary.size(), decodeStart);
+			if (outermost) self.receiving = false;
+		}
+	}
+	static void receiveBinary(void *context, const unsigned char *bytes, size_t length) {
+		auto &self = *(BasicWebviewGui *)context;
+		if (Framing::frameSize > 0 && length != Framing::frameSize) return;
+		self.deliver(bytes, length, Metrics::now());
+	}
+};
+
+} // namespace
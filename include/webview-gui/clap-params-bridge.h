@@ -0,0 +1,350 @@
+#pragma once
+
+#include "./clap-webview-gui.h"
+
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cstring>
+
+namespace webview_gui {
+
+/* Mirrors a plugin's `clap.params` into the page, and turns GUI edits into CLAP events for the audio thread.
+
+This is layered on top of `ClapWebviewGui`.  With a native webview it uses its own channel (so it works alongside `webviewGui.useWorker()`), and with a host-provided one it shares the plain messages.  Every message from this bridge starts with a 4-byte tag, and numbers are little-endian:
+
+	C++ -> page:
+		"prmT" (table): u32 count, then for each parameter:
+			u32 id, u32 flags, f64 min, f64 max, f64 default, f64 value, u16 name length, name (UTF-8), u16 module length, module (UTF-8)
+		"prmV" (values changed since the last frame): u32 count, then (u32 id, f64 value) for each
+	page -> C++:
+		"prmR" (re-send the table, e.g. after a reload)
+		"prmB" u32 id (gesture begin)
+		"prmA" u32 id, f64 value (adjust)
+		"prmE" u32 id (gesture end)
+
+`ClapParamsBridge::jsSource` implements the page side, and can be served from your `get_resource()`.  Include it before your own code, since (without the channel) it hides the bridge's messages from other `message` listeners.
+*/
+struct ClapParamsBridge {
+	static constexpr const char *channelName = "webview-gui/clap-params";
+
+	ClapParamsBridge(ClapWebviewGui &gui, size_t eventCapacity=1024) : gui(gui), guiEvents(eventCapacity) {
+		gui.channel(channelName, [this](const unsigned char *bytes, size_t length){
+			receive(bytes, uint32_t(length));
+		});
+	}
+	~ClapParamsBridge() {
+		gui.channel(channelName, nullptr);
+	}
+	// Registered with the `ClapWebviewGui` by address
+	ClapParamsBridge(const ClapParamsBridge &other) = delete;
+
+	// Call from `plugin.init()`, after `ClapWebviewGui::init()`, and again (when deactivated) after a parameter rescan
+	void init(const clap_plugin *initPlugin, const clap_host *initHost) {
+		plugin = initPlugin;
+		host = initHost;
+		pluginParams = (const clap_plugin_params *)plugin->get_extension(plugin, CLAP_EXT_PARAMS);
+		hostParams = (const clap_host_params *)host->get_extension(host, CLAP_EXT_PARAMS);
+		rescan();
+	}
+	void rescan() {
+		entries.clear();
+		if (!pluginParams) return;
+		auto count = pluginParams->count(plugin);
+		entries.reserve(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			clap_param_info info;
+			if (pluginParams->get_info(plugin, i, &info)) entries.push_back({info.id});
+		}
+		// Sorted by ID, so `setValue()` can find them without a map
+		std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b){
+			return a.id < b.id;
+		});
+		values.reset(new Value[entries.size()]);
+		// Worst case: every parameter changing in one frame
+		messageBuffer.reserve(8 + entries.size()*12);
+		sendTable();
+	}
+
+	// Sends the full table, e.g. when the GUI is (re)opened - the page also asks for this when it loads
+	void sendTable() {
+		if (!pluginParams) return;
+		std::vector<unsigned char> message;
+		writeTag(message, "prmT");
+		writeU32(message, uint32_t(entries.size()));
+		// Anything pending is covered by the table - cleared first, so changes made while we read are sent by the next `flush()`
+		for (size_t i = 0; i < entries.size(); ++i) values[i].dirty.exchange(false, std::memory_order_acq_rel);
+		auto count = pluginParams->count(plugin);
+		for (uint32_t i = 0; i < count; ++i) {
+			clap_param_info info;
+			if (!pluginParams->get_info(plugin, i, &info)) continue;
+			double value = info.default_value;
+			pluginParams->get_value(plugin, info.id, &value);
+			writeU32(message, info.id);
+			writeU32(message, info.flags);
+			writeF64(message, info.min_value);
+			writeF64(message, info.max_value);
+			writeF64(message, info.default_value);
+			writeF64(message, value);
+			writeString(message, info.name);
+			writeString(message, info.module);
+		}
+		send(message);
+	}
+
+	// Any thread (including audio): records a value for the page.  Changes to the same parameter are coalesced until the next `flush()`.
+	void setValue(clap_id id, double value) {
+		auto *v = find(id);
+		if (!v) return;
+		v->value.store(value, std::memory_order_relaxed);
+		v->dirty.store(true, std::memory_order_release);
+		anyDirty.store(true, std::memory_order_release);
+	}
+
+	// Main thread, once per UI frame: sends all values which changed since the last flush, as a single message
+	void flush() {
+		if (!anyDirty.exchange(false, std::memory_order_acq_rel)) return;
+		messageBuffer.clear();
+		writeTag(messageBuffer, "prmV");
+		writeU32(messageBuffer, 0);
+		uint32_t count = 0;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			auto &v = values[i];
+			if (!v.dirty.exchange(false, std::memory_order_acq_rel)) continue;
+			writeU32(messageBuffer, entries[i].id);
+			writeF64(messageBuffer, v.value.load(std::memory_order_relaxed));
+			++count;
+		}
+		if (!count) return;
+		for (int b = 0; b < 4; ++b) messageBuffer[4 + b] = (unsigned char)(count >> (b*8));
+		send(messageBuffer);
+	}
+
+	// Call at the start of your webview `receive()` (only needed for host-provided webviews): returns `true` if the message belonged to the bridge
+	bool receive(const void *buffer, uint32_t size) {
+		auto *bytes = (const unsigned char *)buffer;
+		if (size < 4 || std::memcmp(bytes, "prm", 3)) return false;
+		char kind = char(bytes[3]);
+		if (kind == 'R') {
+			sendTable();
+			return true;
+		}
+		if (size < 8) return false;
+		GuiEvent event;
+		event.id = readU32(bytes + 4);
+		if (kind == 'B') {
+			event.type = CLAP_EVENT_PARAM_GESTURE_BEGIN;
+		} else if (kind == 'E') {
+			event.type = CLAP_EVENT_PARAM_GESTURE_END;
+		} else if (kind == 'A' && size >= 16) {
+			event.type = CLAP_EVENT_PARAM_VALUE;
+			event.value = readF64(bytes + 8);
+		} else {
+			return false;
+		}
+		if (!find(event.id)) return true; // unknown parameter
+		if (!guiEvents.push(event)) {
+			droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		} else if (hostParams) {
+			// Make sure these get picked up, even if we're not currently processing
+			hostParams->request_flush(host);
+		}
+		return true;
+	}
+
+	/* Audio thread, from `process()` or `params.flush()`: takes up to `maxEvents` GUI edits.
+
+	Each is passed to `apply(const clap_event_header *)` (so the plugin can update its state, as if it were an input event), and then pushed to `out` (if provided) so the host can record it.  This is wait-free and doesn't allocate.
+	*/
+	template<class Apply>
+	uint32_t process(const clap_output_events *out, Apply &&apply, uint32_t maxEvents=uint32_t(-1)) {
+		uint32_t count = 0;
+		GuiEvent event;
+		while (count < maxEvents && guiEvents.pop(event)) {
+			++count;
+			if (event.type == CLAP_EVENT_PARAM_VALUE) {
+				clap_event_param_value valueEvent{
+					{sizeof(clap_event_param_value), 0, CLAP_CORE_EVENT_SPACE_ID, uint16_t(event.type), 0},
+					event.id, nullptr, -1, -1, -1, -1, event.value
+				};
+				apply(&valueEvent.header);
+				if (out) out->try_push(out, &valueEvent.header);
+			} else {
+				clap_event_param_gesture gestureEvent{
+					{sizeof(clap_event_param_gesture), 0, CLAP_CORE_EVENT_SPACE_ID, uint16_t(event.type), 0},
+					event.id
+				};
+				apply(&gestureEvent.header);
+				if (out) out->try_push(out, &gestureEvent.header);
+			}
+		}
+		return count;
+	}
+
+	// GUI edits lost because the queue was full
+	size_t dropped() const {
+		return droppedEvents.load(std::memory_order_relaxed);
+	}
+
+	static constexpr const char *jsSource = R"JS(
+	(()=>{
+		class ClapParams extends EventTarget {
+			params = [];
+			byId = new Map();
+
+			// The runtime's channel if there is one (native webviews), or plain messages for host-provided webviews
+			#channel = (window.webviewGui && webviewGui.channel) ? webviewGui.channel('webview-gui/clap-params') : null;
+
+			constructor() {
+				super();
+				let handle = e=>{
+					if (!(e.data instanceof ArrayBuffer) || e.data.byteLength < 4) return;
+					let tag = new Uint8Array(e.data, 0, 4);
+					if (String.fromCharCode(...tag.subarray(0, 3)) != 'prm') return;
+					e.stopImmediatePropagation();
+					let view = new DataView(e.data);
+					if (tag[3] == 84/*T*/) this.#readTable(view);
+					if (tag[3] == 86/*V*/) this.#readValues(view);
+				};
+				if (this.#channel) {
+					this.#channel.addEventListener('message', handle);
+				} else {
+					window.addEventListener('message', handle, {capture: true});
+				}
+				this.#post('R');
+			}
+			begin(id) {
+				this.#post('B', id);
+			}
+			adjust(id, value) {
+				let param = this.byId.get(id);
+				if (param) param.value = value;
+				this.#post('A', id, value);
+			}
+			end(id) {
+				this.#post('E', id);
+			}
+
+			#post(kind, id, value) {
+				let view = new DataView(new ArrayBuffer(id == null ? 4 : (value == null ? 8 : 16)));
+				'prm'.split('').concat(kind).forEach((c, i)=>view.setUint8(i, c.charCodeAt(0)));
+				if (id != null) view.setUint32(4, id, true);
+				if (value != null) view.setFloat64(8, value, true);
+				if (this.#channel) {
+					this.#channel.send(view.buffer);
+				} else {
+					window.parent.postMessage(view.buffer, '*', [view.buffer]);
+				}
+			}
+			#readTable(view) {
+				let decoder = new TextDecoder(), pos = 8;
+				let readString = ()=>{
+					let length = view.getUint16(pos, true);
+					let str = decoder.decode(new Uint8Array(view.buffer, pos + 2, length));
+					pos += 2 + length;
+					return str;
+				};
+				this.params = [];
+				this.byId = new Map();
+				for (let i = view.getUint32(4, true); i > 0; --i) {
+					let param = {
+						id: view.getUint32(pos, true),
+						flags: view.getUint32(pos + 4, true),
+						min: view.getFloat64(pos + 8, true),
+						max: view.getFloat64(pos + 16, true),
+						defaultValue: view.getFloat64(pos + 24, true),
+						value: view.getFloat64(pos + 32, true)
+					};
+					pos += 40;
+					param.name = readString();
+					param.module = readString();
+					this.params.push(param);
+					this.byId.set(param.id, param);
+				}
+				this.dispatchEvent(new Event('table'));
+			}
+			#readValues(view) {
+				let changed = [];
+				for (let i = 0, count = view.getUint32(4, true); i < count; ++i) {
+					let param = this.byId.get(view.getUint32(8 + i*12, true));
+					if (!param) continue;
+					param.value = view.getFloat64(12 + i*12, true);
+					changed.push(param);
+				}
+				this.dispatchEvent(new CustomEvent('change', {detail: changed}));
+			}
+		}
+		window.clapParams = new ClapParams();
+	})();
+	)JS";
+
+private:
+	ClapWebviewGui &gui;
+	const clap_plugin *plugin = nullptr;
+	const clap_host *host = nullptr;
+	const clap_plugin_params *pluginParams = nullptr;
+	const clap_host_params *hostParams = nullptr;
+
+	struct Entry {
+		clap_id id;
+	};
+	std::vector<Entry> entries;
+	struct Value {
+		std::atomic<double> value{0};
+		std::atomic<bool> dirty{false};
+	};
+	std::unique_ptr<Value[]> values;
+	std::atomic<bool> anyDirty{false};
+	std::vector<unsigned char> messageBuffer;
+
+	struct GuiEvent {
+		uint16_t type = 0;
+		clap_id id = 0;
+		double value = 0;
+	};
+	helpers::SpscQueue<GuiEvent> guiEvents;
+	std::atomic<size_t> droppedEvents{0};
+
+	void send(const std::vector<unsigned char> &message) {
+		if (!gui.send(channelName, message.data(), message.size())) gui.send(message.data(), message.size());
+	}
+
+	Value * find(clap_id id) {
+		auto iter = std::lower_bound(entries.begin(), entries.end(), id, [](const Entry &e, clap_id id){
+			return e.id < id;
+		});
+		if (iter == entries.end() || iter->id != id) return nullptr;
+		return &values[iter - entries.begin()];
+	}
+
+	static void writeTag(std::vector<unsigned char> &message, const char *tag) {
+		message.insert(message.end(), tag, tag + 4);
+	}
+	static void writeU32(std::vector<unsigned char> &message, uint32_t v) {
+		for (int b = 0; b < 4; ++b) message.push_back((unsigned char)(v >> (b*8)));
+	}
+	static void writeF64(std::vector<unsigned char> &message, double d) {
+		uint64_t v;
+		std::memcpy(&v, &d, 8);
+		for (int b = 0; b < 8; ++b) message.push_back((unsigned char)(v >> (b*8)));
+	}
+	static void writeString(std::vector<unsigned char> &message, const char *str) {
+		auto length = uint16_t(std::min<size_t>(std::strlen(str), 0xFFFF));
+		message.push_back((unsigned char)length);
+		message.push_back((unsigned char)(length >> 8));
+		message.insert(message.end(), str, str + length);
+	}
+	static uint32_t readU32(const unsigned char *bytes) {
+		return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+	}
+	static double readF64(const unsigned char *bytes) {
+		uint64_t v = 0;
+		for (int b = 0; b < 8; ++b) v |= uint64_t(bytes[b]) << (b*8);
+		double d;
+		std::memcpy(&d, &v, 8);
+		return d;
+	}
+};
+
+} // namespace
@@ -2,14 +2,20 @@
 
 #include "clap/clap.h"
 #include "webview-gui.h"
+#include "snapshot-cache.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <cstring>
 #include <cctype>
 #include <algorithm>
-#include <mutex>
-#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
 #include <unordered_map>
+#include <functional>
+#include <utility>
 
 namespace webview_gui {
 
@@ -33,12 +39,30 @@ struct ClapWebviewGui {
 	// If no native webview is active, then this forwards to the actual host extension anyway
 	const clap_host_webview *extHostWebview;
 
+	// Used to coalesce resizes (and drive the GTK loop on Linux) - if you implement `clap.timer-support` yourself, call `onTimer()` from it instead
+	const clap_plugin_timer_support *extPluginTimerSupport;
+	// Used to drive the GTK loop from the host's loop on Linux - if you implement `clap.posix-fd-support` yourself, call `onFd()` from it instead
+	const clap_plugin_posix_fd_support *extPluginPosixFdSupport;
+
+	// A snapshot is taken when the native GUI is hidden (not on destroy, since capturing is asynchronous and would be cancelled by the teardown), and shown (for the same plugin ID and size) while the next one loads - set to null to disable
+	std::shared_ptr<SnapshotCache> snapshotCache = SnapshotCache::shared();
+	// Passed to `WebviewGui::create()` - if `perPluginData` is set and there's no `dataDirectory`, it's `WebviewGui::defaultDataDirectory()` for the plugin ID, so WebKit's caches persist across sessions without being shared with the host or other plugins (macOS 14+ only).  Off by default: turning it on moves an existing plugin to a new, empty data store, so anything the page kept in the default one (`localStorage`, IndexedDB) is left behind.
+	WebviewGui::Options webviewOptions;
+	bool perPluginData = false;
+
 	ClapWebviewGui(const clap_plugin *plugin=nullptr, const clap_host *host=nullptr) : plugin(plugin), host(host) {
 		setSelf(plugin);
 		setSelf(host);
 		extPluginGui = &pluginGuiProxy;
 		extHostWebview = &hostWebviewProxy;
+		extPluginTimerSupport = &pluginTimerProxy;
+		extPluginPosixFdSupport = &pluginPosixFdProxy;
+	}
+	~ClapWebviewGui() {
+		clearSelf(plugin);
+		clearSelf(host);
 	}
+	ClapWebviewGui(const ClapWebviewGui &other) = delete;
 	
 	// Call from `plugin.init()`
 	void init(const clap_plugin *initPlugin, const clap_host *initHost) {
@@ -54,6 +78,8 @@ struct ClapWebviewGui {
 	void init() {
 		pluginWebview = (const clap_plugin_webview *)plugin->get_extension(plugin, CLAP_EXT_WEBVIEW);
 		hostWebview = (const clap_host_webview *)host->get_extension(host, CLAP_EXT_WEBVIEW);
+		hostTimerSupport = (const clap_host_timer_support *)host->get_extension(host, CLAP_EXT_TIMER_SUPPORT);
+		hostPosixFdSupport = (const clap_host_posix_fd_support *)host->get_extension(host, CLAP_EXT_POSIX_FD_SUPPORT);
 	}
 	
 	/* ---- Plugin GUI methods ----
@@ -90,6 +116,8 @@ struct ClapWebviewGui {
 
 		auto platform = clapApiToPlatform(api);
 		WebviewGui *ptr;
+		auto options = webviewOptions;
+		if (perPluginData && options.dataDirectory.empty() && !snapshotId().empty()) options.dataDirectory = WebviewGui::defaultDataDirectory(snapshotId());
 
 		if (startUrl.substr(0, 5) == "file:") { // absolute file path
 			// strip `file:` and all leading `/`s
@@ -111,7 +139,7 @@ struct ClapWebviewGui {
 			// We stripped the `/` above, add it back in
 			if (baseDir[0] != '/') baseDir = "/" + baseDir;
 #endif
-			ptr = WebviewGui::create(platform, startUrl.c_str(), baseDir);
+			ptr = WebviewGui::create(platform, startUrl.c_str(), baseDir, options);
 		} else {
 			ptr = WebviewGui::create(platform, startUrl.c_str(), [this](const char *path, WebviewGui::Resource &resource){
 				if (!pluginWebview) return false;
@@ -133,7 +161,7 @@ struct ClapWebviewGui {
 				bool success = pluginWebview->get_resource(plugin, path, mediaType, 255, &resourceStream);
 				if (success) resource.mediaType = mediaType;
 				return success;
-			});
+			}, options);
 		}
 		if (!ptr) return false;
 
@@ -143,14 +171,20 @@ struct ClapWebviewGui {
 				pluginWebview->receive(plugin, (const void *)bytes, uint32_t(length));
 			}
 		};
+		for (auto &pair : channelHandlers) nativeWebview->channel(pair.first, pair.second);
+		// We don't own the GTK main loop, so drive it from the host's
+		if (platform == WebviewGui::X11EMBED) syncEventLoop();
 		return true;
 	}
 
 	void destroy() {
+		stopResizeTimer();
 		nativeWebview = nullptr;
+		shown = false;
+		stopEventLoop();
 	}
 	
-	bool setScale(double scale) {
+	bool setScale(double /*scale*/) {
 		return true;
 	}
 	
@@ -169,35 +203,53 @@ struct ClapWebviewGui {
 		return true;
 	}
 	
-	bool adjustSize(uint32_t *w, uint32_t *h) {
+	bool adjustSize(uint32_t * /*w*/, uint32_t * /*h*/) {
 		return true;
 	}
 
+	/* Hosts can call this at mouse-move rate while dragging, so (if the host supports timers) native resizes are coalesced to at most one per frame.
+	The first change is applied immediately, and the latest size within a frame wins - including a final trailing one.
+	*/
 	bool setSize(uint32_t w, uint32_t h) {
 		width = w;
 		height = h;
-		if (nativeWebview) nativeWebview->setSize(w, h);
+		if (!nativeWebview) return true;
+		auto now = std::chrono::steady_clock::now();
+		if (!resizeTimerActive && now - lastResize >= resizeInterval) {
+			applySize();
+			lastResize = now;
+			// Start the timer anyway, to catch any changes within this frame
+			if (hostTimerSupport && hostTimerSupport->register_timer(host, resizeIntervalMs, &resizeTimerId)) {
+				resizeTimerActive = true;
+			}
+		} else if (resizeTimerActive) {
+			resizePending = true;
+		} else {
+			applySize(); // no timer support, so we can't coalesce
+		}
 		return true;
 	}
 	
 	bool setParent(const clap_window *window) {
 		if (nativeWebview) {
 			nativeWebview->attach(window->ptr);
+			if (snapshotCache) nativeWebview->showPlaceholder(snapshotCache->get(snapshotId(), int(width), int(height)));
 			return true;
 		}
 		return false;
 	}
 	
-	bool setTransient(const clap_window *window) {
+	bool setTransient(const clap_window * /*window*/) {
 		// TODO: this
 		return false;
 	}
 	
-	void suggestTitle(const char *title) {}
+	void suggestTitle(const char * /*title*/) {}
 	
 	bool show() {
 		if (nativeWebview) {
 			nativeWebview->setVisible(true);
+			shown = true;
 			return true;
 		}
 		return false;
@@ -205,12 +257,50 @@ struct ClapWebviewGui {
 	
 	bool hide() {
 		if (nativeWebview) {
+			// Before hiding, while it's still rendered
+			if (shown) captureSnapshot();
 			nativeWebview->setVisible(false);
+			shown = false;
 			return true;
 		}
 		return false;
 	}
 
+	/* ---- Plugin timer-support methods ---- */
+
+	// Returns `true` if the timer was one of ours
+	bool onTimer(clap_id timerId) {
+		if (eventTimerActive && timerId == eventTimerId) {
+			WebviewGui::processEvents();
+			syncEventLoop();
+			return true;
+		}
+		if (!resizeTimerActive || timerId != resizeTimerId) return false;
+		if (resizePending && nativeWebview) {
+			resizePending = false;
+			applySize();
+			lastResize = std::chrono::steady_clock::now();
+		} else {
+			// A whole frame without changes, so the resize has settled
+			stopResizeTimer();
+		}
+		return true;
+	}
+
+	/* ---- Plugin posix-fd-support methods ---- */
+
+	// Returns `true` if the FD was one of ours
+	bool onFd(int fd, clap_posix_fd_flags_t /*flags*/) {
+		for (auto &pair : registeredFds) {
+			if (pair.first == fd) {
+				WebviewGui::processEvents();
+				syncEventLoop();
+				return true;
+			}
+		}
+		return false;
+	}
+
 	/* ---- Host Webview methods ----
 	
 	This is what the replacement host extension calls, but if using that weirds you out, you can call this instead.
@@ -227,6 +317,21 @@ struct ClapWebviewGui {
 		}
 		return false;
 	}
+
+	// Named channels (see `WebviewGui::channel()`), kept across `destroy()`/`create()`.  Host-provided webviews have no runtime, so these only reach a native webview.
+	void channel(const std::string &name, std::function<void(const unsigned char *, size_t)> handler) {
+		channelHandlers.erase(std::remove_if(channelHandlers.begin(), channelHandlers.end(), [&](const std::pair<std::string, ChannelHandler> &pair){
+			return pair.first == name;
+		}), channelHandlers.end());
+		if (handler) channelHandlers.emplace_back(name, handler);
+		if (nativeWebview) nativeWebview->channel(name, std::move(handler));
+	}
+	// Returns `false` if there's no native webview
+	bool send(const std::string &channelName, const void *buffer, size_t length) {
+		if (!nativeWebview) return false;
+		nativeWebview->send(nativeWebview->channel(channelName), (const unsigned char *)buffer, length);
+		return true;
+	}
 	
 private:
 	uint32_t width = 400, height = 250;
@@ -234,25 +339,134 @@ private:
 	const clap_host *host = nullptr;
 
 	std::unique_ptr<WebviewGui> nativeWebview;
+	bool shown = false;
+	using ChannelHandler = std::function<void(const unsigned char *, size_t)>;
+	std::vector<std::pair<std::string, ChannelHandler>> channelHandlers;
+
+	std::string snapshotId() const {
+		return (plugin && plugin->desc && plugin->desc->id) ? plugin->desc->id : "";
+	}
+	// The callback can happen after we're gone, so it only holds the cache
+	void captureSnapshot() {
+		if (!snapshotCache) return;
+		auto cache = snapshotCache;
+		auto id = snapshotId();
+		int w = int(width), h = int(height);
+		nativeWebview->captureSnapshot([cache, id, w, h](std::vector<unsigned char> png){
+			cache->put(id, w, h, std::move(png));
+		});
+	}
+
+	// Resize coalescing
+	static constexpr uint32_t resizeIntervalMs = 16;
+	static constexpr std::chrono::milliseconds resizeInterval{resizeIntervalMs};
+	const clap_host_timer_support *hostTimerSupport = nullptr;
+	clap_id resizeTimerId = CLAP_INVALID_ID;
+	bool resizeTimerActive = false, resizePending = false;
+	std::chrono::steady_clock::time_point lastResize;
+
+	// Event-loop integration: without FD support the timer polls every `eventIntervalMs`, but with it the timer only covers GLib's next timeout (rounded down to a power of two, so it's only re-registered when that changes a lot)
+	static constexpr uint32_t eventIntervalMs = 16, maxEventIntervalMs = 4096;
+	uint32_t eventTimerMs = 0;
+	const clap_host_posix_fd_support *hostPosixFdSupport = nullptr;
+	std::vector<WebviewGui::EventFd> eventFds;
+	std::vector<std::pair<int, clap_posix_fd_flags_t>> registeredFds;
+	clap_id eventTimerId = CLAP_INVALID_ID;
+	bool eventTimerActive = false, eventLoopActive = false;
+
+	// Updates our registered FDs/timer to match what the platform wants
+	void syncEventLoop() {
+		if (!nativeWebview && !eventLoopActive) return;
+		eventLoopActive = true;
+		int timeout = WebviewGui::getEventFds(eventFds);
+		if (hostPosixFdSupport) {
+			std::vector<std::pair<int, clap_posix_fd_flags_t>> wanted;
+			for (auto &eventFd : eventFds) {
+				clap_posix_fd_flags_t flags = (eventFd.read ? CLAP_POSIX_FD_READ : 0) | (eventFd.write ? CLAP_POSIX_FD_WRITE : 0) | (eventFd.error ? CLAP_POSIX_FD_ERROR : 0);
+				auto iter = std::find_if(wanted.begin(), wanted.end(), [&](auto &pair){return pair.first == eventFd.fd;});
+				if (iter == wanted.end()) {
+					wanted.emplace_back(eventFd.fd, flags);
+				} else {
+					iter->second |= flags;
+				}
+			}
+			for (auto &pair : registeredFds) {
+				auto iter = std::find_if(wanted.begin(), wanted.end(), [&](auto &w){return w.first == pair.first;});
+				if (iter == wanted.end()) hostPosixFdSupport->unregister_fd(host, pair.first);
+			}
+			for (auto &pair : wanted) {
+				auto iter = std::find_if(registeredFds.begin(), registeredFds.end(), [&](auto &r){return r.first == pair.first;});
+				if (iter == registeredFds.end()) {
+					hostPosixFdSupport->register_fd(host, pair.first, pair.second);
+				} else if (iter->second != pair.second) {
+					hostPosixFdSupport->modify_fd(host, pair.first, pair.second);
+				}
+			}
+			registeredFds = std::move(wanted);
+		}
+		// Without FD support, we have to poll
+		bool wantTimer = timeout >= 0 || (!hostPosixFdSupport && !eventFds.empty());
+		uint32_t periodMs = eventIntervalMs;
+		if (hostPosixFdSupport && timeout >= 0) {
+			while (periodMs*2 <= uint32_t(timeout) && periodMs*2 <= maxEventIntervalMs) periodMs *= 2;
+		}
+		if (eventTimerActive && (!wantTimer || periodMs != eventTimerMs)) {
+			hostTimerSupport->unregister_timer(host, eventTimerId);
+			eventTimerActive = false;
+		}
+		if (wantTimer && !eventTimerActive && hostTimerSupport) {
+			eventTimerActive = hostTimerSupport->register_timer(host, periodMs, &eventTimerId);
+			eventTimerMs = periodMs;
+		}
+	}
+	void stopEventLoop() {
+		if (hostPosixFdSupport) {
+			for (auto &pair : registeredFds) hostPosixFdSupport->unregister_fd(host, pair.first);
+		}
+		registeredFds.clear();
+		if (eventTimerActive && hostTimerSupport) hostTimerSupport->unregister_timer(host, eventTimerId);
+		eventTimerActive = eventLoopActive = false;
+	}
+
+	void applySize() {
+		nativeWebview->setSize(width, height);
+	}
+	void stopResizeTimer() {
+		if (resizeTimerActive && hostTimerSupport) hostTimerSupport->unregister_timer(host, resizeTimerId);
+		resizeTimerActive = resizePending = false;
+	}
 
 	// Map used to create proxy plugin/host extensions, even though they're called with `plugin`/`host` arguments
+	// Lookups are lock-free, since `host_webview_send()` in particular can be called a lot, from many instances
 	// C++17 inline variables are really useful for this
-	inline static std::unordered_map<size_t, ClapWebviewGui*> pointerMap;
-	inline static std::shared_mutex pointerMapMutex;
+	inline static helpers::AtomicPointerMap<ClapWebviewGui> pointerMap;
+	// Only used once `pointerMap` is full: locked, but skipped entirely while it's empty
+	inline static std::mutex overflowMutex;
+	inline static std::unordered_map<const void *, ClapWebviewGui *> overflowMap;
+	inline static std::atomic<size_t> overflowSize{0};
 
-	static ClapWebviewGui & getSelf(const void *pluginOrHost) {
-		std::shared_lock guard{pointerMapMutex};
-		return *pointerMap[(size_t)pluginOrHost];
+	static ClapWebviewGui * getSelf(const void *pluginOrHost) {
+		if (auto *self = pointerMap.get(pluginOrHost)) return self;
+		if (!overflowSize.load(std::memory_order_acquire)) return nullptr;
+		std::lock_guard<std::mutex> guard{overflowMutex};
+		auto iter = overflowMap.find(pluginOrHost);
+		return (iter == overflowMap.end()) ? nullptr : iter->second;
 	}
 	void setSelf(const void *pluginOrHost) {
 		if (!pluginOrHost) return;
-		std::unique_lock guard{pointerMapMutex};
-		pointerMap.insert_or_assign((size_t)pluginOrHost, this);
+		if (pointerMap.set(pluginOrHost, this)) return;
+		std::lock_guard<std::mutex> guard{overflowMutex};
+		overflowMap[pluginOrHost] = this;
+		overflowSize.store(overflowMap.size(), std::memory_order_release);
 	}
 	void clearSelf(const void *pluginOrHost) {
 		if (!pluginOrHost) return;
-		std::unique_lock guard{pointerMapMutex};
-		pointerMap.erase((size_t)pluginOrHost);
+		pointerMap.erase(pluginOrHost, this);
+		if (!overflowSize.load(std::memory_order_acquire)) return;
+		std::lock_guard<std::mutex> guard{overflowMutex};
+		auto iter = overflowMap.find(pluginOrHost);
+		if (iter != overflowMap.end() && iter->second == this) overflowMap.erase(iter);
+		overflowSize.store(overflowMap.size(), std::memory_order_release);
 	}
 	
 	char startUrlBuffer[2048] = {0};
@@ -292,13 +506,19 @@ private:
 		return platform;
 	}
 
-	const clap_plugin_webview *pluginWebview;
-	const clap_host_webview *hostWebview;
+	const clap_plugin_webview *pluginWebview = nullptr;
+	const clap_host_webview *hostWebview = nullptr;
 
 	// Our proxies
 	clap_host_webview hostWebviewProxy{
 		host_webview_send
 	};
+	clap_plugin_timer_support pluginTimerProxy{
+		timer_on_timer
+	};
+	clap_plugin_posix_fd_support pluginPosixFdProxy{
+		posix_fd_on_fd
+	};
 	clap_plugin_gui pluginGuiProxy{
 		gui_is_api_supported,
 		gui_get_preferred_api,
@@ -318,52 +538,72 @@ private:
 	};
 	// Static methods for our proxies
 	static bool gui_is_api_supported(const clap_plugin *plugin, const char *api, bool is_floating) {
-		return getSelf(plugin).isApiSupported(api, is_floating);
+		auto *self = getSelf(plugin);
+		return self && self->isApiSupported(api, is_floating);
 	}
 	static bool gui_get_preferred_api(const clap_plugin *plugin, const char **api, bool *is_floating) {
-		return getSelf(plugin).getPreferredApi(api, is_floating);
+		auto *self = getSelf(plugin);
+		return self && self->getPreferredApi(api, is_floating);
 	}
 	static bool gui_create(const clap_plugin *plugin, const char *api, bool is_floating) {
-		return getSelf(plugin).create(api, is_floating);
+		auto *self = getSelf(plugin);
+		return self && self->create(api, is_floating);
 	}
 	static void gui_destroy(const clap_plugin *plugin) {
-		return getSelf(plugin).destroy();
+		if (auto *self = getSelf(plugin)) self->destroy();
 	}
 	static bool gui_set_scale(const clap_plugin *plugin, double scale) {
-		return getSelf(plugin).setScale(scale);
+		auto *self = getSelf(plugin);
+		return self && self->setScale(scale);
 	}
 	static bool gui_get_size(const clap_plugin *plugin, uint32_t *w, uint32_t *h) {
-		return getSelf(plugin).getSize(w, h);
+		auto *self = getSelf(plugin);
+		return self && self->getSize(w, h);
 	}
 	static bool gui_can_resize(const clap_plugin *plugin) {
-		return getSelf(plugin).canResize();
+		auto *self = getSelf(plugin);
+		return self && self->canResize();
 	}
 	static bool gui_get_resize_hints(const clap_plugin *plugin, clap_gui_resize_hints_t *hints) {
-		return getSelf(plugin).getResizeHints(hints);
+		auto *self = getSelf(plugin);
+		return self && self->getResizeHints(hints);
 	}
 	static bool gui_adjust_size(const clap_plugin *plugin, uint32_t *w, uint32_t *h) {
-		return getSelf(plugin).adjustSize(w, h);
+		auto *self = getSelf(plugin);
+		return self && self->adjustSize(w, h);
 	}
 	static bool gui_set_size(const clap_plugin *plugin, uint32_t w, uint32_t h) {
-		return getSelf(plugin).setSize(w, h);
+		auto *self = getSelf(plugin);
+		return self && self->setSize(w, h);
 	}
 	static bool gui_set_parent(const clap_plugin *plugin, const clap_window *window) {
-		return getSelf(plugin).setParent(window);
+		auto *self = getSelf(plugin);
+		return self && self->setParent(window);
 	}
 	static bool gui_set_transient(const clap_plugin *plugin, const clap_window *window) {
-		return getSelf(plugin).setTransient(window);
+		auto *self = getSelf(plugin);
+		return self && self->setTransient(window);
 	}
 	static void gui_suggest_title(const clap_plugin *plugin, const char *title) {
-		return getSelf(plugin).suggestTitle(title);
+		if (auto *self = getSelf(plugin)) self->suggestTitle(title);
 	}
 	static bool gui_show(const clap_plugin *plugin) {
-		return getSelf(plugin).show();
+		auto *self = getSelf(plugin);
+		return self && self->show();
 	}
 	static bool gui_hide(const clap_plugin *plugin) {
-		return getSelf(plugin).hide();
+		auto *self = getSelf(plugin);
+		return self && self->hide();
+	}
+	static void timer_on_timer(const clap_plugin *plugin, clap_id timerId) {
+		if (auto *self = getSelf(plugin)) self->onTimer(timerId);
+	}
+	static void posix_fd_on_fd(const clap_plugin *plugin, int fd, clap_posix_fd_flags_t flags) {
+		if (auto *self = getSelf(plugin)) self->onFd(fd, flags);
 	}
 	static bool host_webview_send(const clap_host_t *host, const void *buffer, uint32_t size) {
-		return getSelf(host).send(buffer, size);
+		auto *self = getSelf(host);
+		return self && self->send(buffer, size);
 	}
 };
 
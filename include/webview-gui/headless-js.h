@@ -0,0 +1,43 @@
+#pragma once
+
+#include "./webview-gui.h"
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Headless JavaScript backend: no native webview, but the page's scripts (and the injected runtime) run in an embedded engine - CHOC's QuickJS - with a minimal shim in place of a browser.
+
+Selected at build time with `WEBVIEW_GUI_HEADLESS_JS` (CMake option of the same name), so the JS half of a GUI (message handling, polyfills, framing) can be measured without WebKit or a display.  It needs CHOC's `choc/javascript` headers.
+
+The start page's `<script>` elements run in order (inline, or `src` fetched through the `ResourceGetter`), and then `DOMContentLoaded` fires.  There's no DOM beyond that - the shim provides `window`/`self`/`parent`, `document` (for events), `EventTarget`, `Event`/`CustomEvent`/`MessageEvent`, `postMessage()`, timers and `requestAnimationFrame()` (run from `WebviewGui::processEvents()`), `performance.now()`, `atob()`/`btoa()`, `TextEncoder`/`TextDecoder` (UTF-8 only), `fetch()` (through the `ResourceGetter`) and `console`.
+*/
+namespace webview_gui { namespace headless_js {
+
+// The running page, as seen by `Options::load`
+struct Page {
+	virtual ~Page() {}
+	// Evaluates JS in the page's global scope (then runs pending promise jobs), filling `resultJson` if given - returns `false` if it threw, which is also reported to `Options::console`
+	virtual bool evaluate(const std::string &code, std::string *resultJson=nullptr) = 0;
+	// Runs any timers which are due (and an animation frame, if one is due and the page is visible), returning milliseconds until the next one, or -1 for none
+	virtual double runTimers() = 0;
+};
+
+struct Options {
+	// Called once the start page's scripts have run and `DOMContentLoaded` has fired
+	std::function<void(Page &)> load;
+	// For `console.*()` and uncaught exceptions - by default these go to stderr
+	std::function<void(const std::string &level, const std::string &text)> console = [](const std::string &level, const std::string &text){
+		std::cerr << "[" << level << "] " << text << std::endl;
+	};
+	// Run after the shim and runtime, but before the page's own scripts (e.g. extra polyfills)
+	std::vector<std::string> initScripts;
+	// Animation frames, while visible
+	double framesPerSecond = 60;
+};
+
+// Each instance copies this when it's created
+inline Options options;
+
+}} // namespace
@@ -4,10 +4,16 @@
 #include <string>
 #include <unordered_map>
 #include <cstring>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <new>
 
 namespace webview_gui { namespace helpers {
 
-inline void decodeBase64(const char *base64, std::vector<unsigned char> &binary) {
+// Appends to any vector of `unsigned char` (e.g. with an `ArenaAllocator`)
+template<class Vector>
+void decodeBase64(const char *base64, Vector &binary) {
 	auto done = [](char c) -> bool {
 		return !c || c == '=';
 	};
@@ -40,14 +46,34 @@ inline void decodeBase64(const char *base64, std::vector<unsigned char> &binary)
 		binary.push_back(((v2&0x03)<<6)|v3);
 	}
 }
+// Exactly how many bytes `decodeBase64()` will produce
+inline size_t decodedBase64Length(const char *base64) {
+	size_t chars = std::strcspn(base64, "=");
+	size_t remainder = chars%4;
+	return chars/4*3 + (remainder ? remainder - 1 : 0) + (remainder == 1);
+}
+// Decodes into memory with room for `decodedBase64Length()` bytes, returning the length
+inline size_t decodeBase64(const char *base64, unsigned char *output) {
+	struct Sink {
+		unsigned char *end;
+		void push_back(unsigned char byte) {
+			*(end++) = byte;
+		}
+	} sink{output};
+	decodeBase64(base64, sink);
+	return size_t(sink.end - output);
+}
 inline std::vector<unsigned char> decodeBase64(const char *base64) {
 	std::vector<unsigned char> binary;
 	decodeBase64(base64, binary);
 	return binary;
 }
 
-inline void encodeBase64(const unsigned char *bytes, size_t length, std::string &base64) {
+// Appends to any `std::basic_string<char>` (e.g. `ArenaString`)
+template<class String>
+void encodeBase64(const unsigned char *bytes, size_t length, String &base64) {
 	static constexpr const char *base64Chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	base64.reserve(base64.size() + (length + 2)/3*4);
 	while (length--) {
 		auto v0 = *(bytes++);
 		// top 6 bits of v0
@@ -83,6 +109,146 @@ inline std::string encodeBase64(const unsigned char *bytes, size_t length) {
 	return base64;
 }
 
+// Appends a double-quoted string (escaped for JSON, which is also a valid JS literal - U+2028/U+2029 are escaped for older JS engines)
+template<class String>
+void appendJsonString(String &json, const char *str, size_t length) {
+	static constexpr const char *hexChars = "0123456789abcdef";
+	json.push_back('"');
+	for (size_t i = 0; i < length; ++i) {
+		auto c = (unsigned char)str[i];
+		if (c == '"' || c == '\\') {
+			json.push_back('\\');
+			json.push_back(char(c));
+		} else if (c < 0x20) {
+			json += "\\u00";
+			json.push_back(hexChars[c>>4]);
+			json.push_back(hexChars[c&0x0F]);
+		} else if (c == 0xE2 && i + 2 < length && (unsigned char)str[i + 1] == 0x80 && ((unsigned char)str[i + 2]&0xFE) == 0xA8) {
+			json += ((unsigned char)str[i + 2] == 0xA8) ? "\\u2028" : "\\u2029";
+			i += 2;
+		} else {
+			json.push_back(char(c));
+		}
+	}
+	json.push_back('"');
+}
+
+/* Open-addressed map from (non-null) pointers to pointers, where lookups never lock.
+
+Insertion/removal are rare and serialised with a mutex.  Removed entries leave a tombstone (reused by later insertions), so a lookup only stops early on a slot which has never been used.  Tombstones at the end of a run are cleared again, so they don't pile up into full-length scans over a long session.
+*/
+template<class Value, size_t capacity=1024>
+struct AtomicPointerMap {
+	static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of 2");
+
+	Value * get(const void *key) const {
+		size_t index = hash(key);
+		for (size_t i = 0; i < capacity; ++i) {
+			auto &slot = slots[(index + i)&(capacity - 1)];
+			auto *slotKey = slot.key.load(std::memory_order_acquire);
+			if (slotKey == key) return slot.value.load(std::memory_order_acquire);
+			if (!slotKey) break; // never-used slot, so it's not further along
+		}
+		return nullptr;
+	}
+
+	// Returns `false` if the map is full
+	bool set(const void *key, Value *value) {
+		std::lock_guard<std::mutex> guard{writeMutex};
+		size_t index = hash(key);
+		Slot *reuse = nullptr;
+		for (size_t i = 0; i < capacity; ++i) {
+			auto &slot = slots[(index + i)&(capacity - 1)];
+			auto *slotKey = slot.key.load(std::memory_order_relaxed);
+			if (slotKey == key) {
+				slot.value.store(value, std::memory_order_release);
+				return true;
+			}
+			if (slotKey == tombstone()) {
+				if (!reuse) reuse = &slot;
+			} else if (!slotKey) {
+				if (!reuse) reuse = &slot;
+				break;
+			}
+		}
+		if (!reuse) return false;
+		// Value before key, so any reader who sees the key also sees the value
+		reuse->value.store(value, std::memory_order_release);
+		reuse->key.store(key, std::memory_order_release);
+		return true;
+	}
+
+	// If `ifValue` is given, the entry is only removed if it (still) points there
+	void erase(const void *key, const Value *ifValue=nullptr) {
+		std::lock_guard<std::mutex> guard{writeMutex};
+		size_t index = hash(key);
+		for (size_t i = 0; i < capacity; ++i) {
+			auto &slot = slots[(index + i)&(capacity - 1)];
+			auto *slotKey = slot.key.load(std::memory_order_relaxed);
+			if (slotKey == key) {
+				if (ifValue && slot.value.load(std::memory_order_relaxed) != ifValue) return;
+				slot.key.store(tombstone(), std::memory_order_release);
+				slot.value.store(nullptr, std::memory_order_release);
+				// If the run ends here, nothing is found by probing past this slot (or any tombstones just before it), so they can be never-used again
+				size_t clear = (index + i)&(capacity - 1);
+				if (slots[(clear + 1)&(capacity - 1)].key.load(std::memory_order_relaxed)) return;
+				for (size_t j = 0; j < capacity && slots[clear].key.load(std::memory_order_relaxed) == tombstone(); ++j) {
+					slots[clear].key.store(nullptr, std::memory_order_release);
+					clear = (clear - 1)&(capacity - 1);
+				}
+				return;
+			}
+			if (!slotKey) return;
+		}
+	}
+private:
+	struct Slot {
+		std::atomic<const void *> key{nullptr};
+		std::atomic<Value *> value{nullptr};
+	};
+	Slot slots[capacity];
+	std::mutex writeMutex;
+
+	static const void * tombstone() {
+		static const char marker = 0;
+		return &marker;
+	}
+	static size_t hash(const void *key) {
+		// Fibonacci hashing, ignoring the low bits (which are mostly zero due to alignment)
+		auto v = uint64_t(size_t(key) >> 4)*0x9E3779B97F4A7C15ull;
+		return size_t(v >> 32);
+	}
+};
+
+// Fixed-capacity single-producer/single-consumer queue: wait-free on both ends, and never allocates after construction
+template<class T>
+struct SpscQueue {
+	SpscQueue(size_t capacity=1024) : items(capacity + 1) {}
+
+	// Returns `false` (dropping the item) if the queue is full
+	bool push(const T &item) {
+		auto w = writeIndex.load(std::memory_order_relaxed);
+		auto next = (w + 1 == items.size()) ? 0 : w + 1;
+		if (next == readIndex.load(std::memory_order_acquire)) return false;
+		items[w] = item;
+		writeIndex.store(next, std::memory_order_release);
+		return true;
+	}
+	bool pop(T &item) {
+		auto r = readIndex.load(std::memory_order_relaxed);
+		if (r == writeIndex.load(std::memory_order_acquire)) return false;
+		item = items[r];
+		readIndex.store((r + 1 == items.size()) ? 0 : r + 1, std::memory_order_release);
+		return true;
+	}
+	bool empty() const {
+		return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+	}
+private:
+	std::vector<T> items;
+	std::atomic<size_t> readIndex{0}, writeIndex{0};
+};
+
 inline std::string guessMediaType(const char *path) {
 	static const std::unordered_map<std::string, std::pair<const char *, const char *>> extMap{
 		{"3g2", {"video", "3gpp2"}},
@@ -547,5 +713,104 @@ inline std::string guessMediaType(const char *path) {
 	return std::string(pair.first) + "/" + pair.second;
 }
 
-}} // namespace
+// Where an `Arena`'s blocks come from - defaults to `::operator new`/`::operator delete`
+struct ArenaUpstream {
+	void * (*allocate)(size_t bytes, void *context) = [](size_t bytes, void *) {
+		return ::operator new(bytes);
+	};
+	void (*deallocate)(void *pointer, size_t bytes, void *context) = [](void *pointer, size_t, void *) {
+		::operator delete(pointer);
+	};
+	void *context = nullptr;
+};
+/* Monotonic arena for transient buffers (e.g. the script built for each message), which is reset once they're done with.
+
+The first block is allocated up-front.  Anything which doesn't fit spills into extra blocks from the upstream allocator, and on `reset()` the largest block is kept, so a steady workload stops allocating at all.
+*/
+struct Arena {
+	using Upstream = ArenaUpstream;
+
+	Arena(size_t initialBytes=4096, Upstream upstream={}) : upstream(upstream) {
+		addBlock(initialBytes);
+	}
+	~Arena() {
+		for (auto &block : blocks) upstream.deallocate(block.start, block.size, upstream.context);
+	}
+	Arena(const Arena &other) = delete;
+
+	void * allocate(size_t bytes, size_t align) {
+		auto *block = &blocks.back();
+		size_t start = (block->used + align - 1)&~(align - 1);
+		if (start + bytes > block->size) {
+			addBlock(std::max(bytes + align, block->size*2));
+			block = &blocks.back();
+			start = (block->used + align - 1)&~(align - 1);
+		}
+		block->used = start + bytes;
+		return block->start + start;
+	}
+	// Everything allocated so far must be finished with
+	void reset() {
+		if (blocks.size() > 1) {
+			// Keep the largest (most recent) block
+			for (size_t i = 0; i + 1 < blocks.size(); ++i) upstream.deallocate(blocks[i].start, blocks[i].size, upstream.context);
+			blocks.erase(blocks.begin(), blocks.end() - 1);
+		}
+		blocks.back().used = 0;
+	}
+	// Also resets, and reallocates the first block from the new upstream
+	void setUpstream(Upstream newUpstream) {
+		size_t size = blocks.back().size;
+		for (auto &block : blocks) upstream.deallocate(block.start, block.size, upstream.context);
+		blocks.clear();
+		upstream = newUpstream;
+		addBlock(size);
+	}
 
+	// Blocks taken from upstream (including the first one), to see whether the initial size is enough
+	size_t upstreamAllocations() const {
+		return allocationCount;
+	}
+private:
+	struct Block {
+		unsigned char *start;
+		size_t size, used;
+	};
+	std::vector<Block> blocks;
+	Upstream upstream;
+	size_t allocationCount = 0;
+
+	void addBlock(size_t size) {
+		auto *start = (unsigned char *)upstream.allocate(size, upstream.context);
+		blocks.push_back({start, size, 0});
+		++allocationCount;
+	}
+};
+
+// Standard allocator which allocates from an `Arena` (and never frees)
+template<class T>
+struct ArenaAllocator {
+	using value_type = T;
+	Arena *arena;
+
+	ArenaAllocator(Arena *arena) : arena(arena) {}
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+	T * allocate(size_t n) {
+		return (T *)arena->allocate(n*sizeof(T), alignof(T));
+	}
+	void deallocate(T *, size_t) {}
+
+	template<class U>
+	bool operator==(const ArenaAllocator<U> &other) const {
+		return arena == other.arena;
+	}
+	template<class U>
+	bool operator!=(const ArenaAllocator<U> &other) const {
+		return arena != other.arena;
+	}
+};
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+}} // namespace
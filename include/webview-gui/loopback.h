@@ -0,0 +1,62 @@
+#pragma once
+
+#include "./webview-gui.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/* In-process loopback backend: no native webview, but the full resource-getter and message-framing paths, with a scripted "page".
+
+Selected at build time with `WEBVIEW_GUI_LOOPBACK` (CMake option of the same name), so the messaging pipeline can be tested and benchmarked without a display.
+*/
+namespace webview_gui { namespace loopback {
+
+// The simulated page, as seen by a `Script`
+struct Page {
+	virtual ~Page() {}
+	// Sends bytes to C++, through the same base64 framing as a real page
+	virtual void post(const unsigned char *bytes, size_t length) = 0;
+	// Gets a channel ID by name (like `webviewGui.channel()`), and sends on that channel
+	virtual uint32_t channel(const std::string &name) = 0;
+	virtual void post(uint32_t channel, const unsigned char *bytes, size_t length) = 0;
+	// Sends a string (like `window.parent.postMessage(string)`)
+	virtual void postText(const std::string &text) = 0;
+	// Requests a resource through the instance's `ResourceGetter`
+	virtual bool fetch(const char *path, WebviewGui::Resource &resource) = 0;
+	virtual double width() const = 0;
+	virtual double height() const = 0;
+	virtual bool visible() const = 0;
+	// While hidden, how long until the page would ask for `memoryPressure()` (or negative for never)
+	virtual double memoryPressureSeconds() const = 0;
+	// Simulates that time passing, like the page's timer firing
+	virtual void hiddenTimeout() = 0;
+};
+
+// Deterministic page behaviour
+struct Script {
+	// Called once the start page has been fetched
+	std::function<void(Page &)> load;
+	// Called for each message from C++ - by default this echoes it straight back
+	std::function<void(Page &, const unsigned char *, size_t)> message = [](Page &page, const unsigned char *bytes, size_t length){
+		page.post(bytes, length);
+	};
+	// Called for each message on a named channel, which by default is also echoed back
+	std::function<void(Page &, uint32_t channel, const unsigned char *, size_t)> channelMessage = [](Page &page, uint32_t channel, const unsigned char *bytes, size_t length){
+		page.post(channel, bytes, length);
+	};
+	// Called for each `sendText()`, which by default is also echoed back
+	std::function<void(Page &, const std::string &)> textMessage = [](Page &page, const std::string &text){
+		page.postText(text);
+	};
+	std::function<void(Page &, double width, double height)> resize;
+	// Called for `WebviewGui::memoryPressure()`, like the `webview-gui-memory-pressure` event
+	std::function<void(Page &)> memoryPressure;
+	// Returns the "rendered" PNG for `WebviewGui::captureSnapshot()` - by default there isn't one
+	std::function<std::vector<unsigned char>(Page &)> snapshot;
+};
+
+// Each instance copies this when it's created
+inline Script script;
+
+}} // namespace
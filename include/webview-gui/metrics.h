@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace webview_gui {
+
+/* Per-instance counters for the messaging layer.  Recording is a few relaxed atomic adds, and `snapshot()` is cheap enough to poll every second.
+
+Define `WEBVIEW_GUI_NO_METRICS` (CMake option `WEBVIEW_GUI_METRICS=OFF`) to compile them out entirely, in which case snapshots are all zero.
+*/
+struct Metrics {
+	using Clock = std::chrono::steady_clock;
+#ifdef WEBVIEW_GUI_NO_METRICS
+	static constexpr bool enabled = false;
+#else
+	static constexpr bool enabled = true;
+#endif
+
+	// Log-bucketed latencies: bucket `i` counts values in [2^i, 2^(i+1)) microseconds, with everything under 2us in bucket 0
+	struct Histogram {
+		static constexpr size_t buckets = 32;
+		uint64_t counts[buckets] = {};
+		uint64_t total = 0;
+
+		// Upper bound of the bucket containing the given fraction (0-1) of values, or 0 if there are none
+		double percentileSeconds(double fraction) const {
+			if (!total) return 0;
+			auto target = uint64_t(fraction*double(total - 1)) + 1;
+			uint64_t sum = 0;
+			for (size_t i = 0; i < buckets; ++i) {
+				sum += counts[i];
+				if (sum >= target) return double(uint64_t(2) << i)*1e-6;
+			}
+			return double(uint64_t(2) << (buckets - 1))*1e-6;
+		}
+	};
+
+	struct Snapshot {
+		uint64_t messagesSent = 0, bytesSent = 0;
+		uint64_t messagesReceived = 0, bytesReceived = 0;
+		double encodeSeconds = 0; // encoding and handing to the platform, for sent messages
+		double decodeSeconds = 0; // for received messages
+		uint64_t heldMessages = 0; // currently held while hidden (see `holdWhileHidden`)
+		uint64_t heldDropped = 0; // dropped while hidden, beyond `maxHeldMessages`
+		uint64_t resourceRequests = 0, resourcesFound = 0, resourceBytes = 0;
+		uint64_t resourceCacheHits = 0; // where the getter set `Resource::fromCache`
+		double resourceSeconds = 0; // total time in the resource getter
+		// Round-trip times from `WebviewGui::probeLatency()`, echoed by the page
+		Histogram roundTrip;
+	};
+
+	Snapshot snapshot() const {
+		Snapshot s;
+#ifndef WEBVIEW_GUI_NO_METRICS
+		s.messagesSent = messagesSent.load(std::memory_order_relaxed);
+		s.bytesSent = bytesSent.load(std::memory_order_relaxed);
+		s.messagesReceived = messagesReceived.load(std::memory_order_relaxed);
+		s.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+		s.encodeSeconds = seconds(encodeNanos);
+		s.decodeSeconds = seconds(decodeNanos);
+		s.heldMessages = heldMessages.load(std::memory_order_relaxed);
+		s.heldDropped = heldDropped.load(std::memory_order_relaxed);
+		s.resourceRequests = resourceRequests.load(std::memory_order_relaxed);
+		s.resourcesFound = resourcesFound.load(std::memory_order_relaxed);
+		s.resourceBytes = resourceBytes.load(std::memory_order_relaxed);
+		s.resourceCacheHits = resourceCacheHits.load(std::memory_order_relaxed);
+		s.resourceSeconds = seconds(resourceNanos);
+		for (size_t i = 0; i < Histogram::buckets; ++i) {
+			s.roundTrip.counts[i] = roundTrip[i].load(std::memory_order_relaxed);
+			s.roundTrip.total += s.roundTrip.counts[i];
+		}
+#endif
+		return s;
+	}
+
+	// A zero time-point when disabled, so callers don't pay for the clock either
+	static Clock::time_point now() {
+#ifdef WEBVIEW_GUI_NO_METRICS
+		return {};
+#else
+		return Clock::now();
+#endif
+	}
+
+	void sent(size_t bytes, Clock::time_point encodeStart) {
+#ifndef WEBVIEW_GUI_NO_METRICS
+		messagesSent.fetch_add(1, std::memory_order_relaxed);
+		bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+		encodeNanos.fetch_add(nanosSince(encodeStart), std::memory_order_relaxed);
+#endif
+	}
+	void received(size_t bytes, Clock::time_point decodeStart) {
+#ifndef WEBVIEW_GUI_NO_METRICS
+		messagesReceived.fetch_add(1, std::memory_order_relaxed);
+		bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+		decodeNanos.fetch_add(nanosSince(decodeStart), std::memory_order_relaxed);
+#endif
+	}
+	void held(size_t count) {
+#ifndef WEBVIEW_GUI_NO_METRICS
+		heldMessages.store(count, std::memory_order_relaxed);
+#endif
+	}
+	void droppedHeld() {
+#ifndef WEBVIEW_GUI_NO_METRICS
+		heldDropped.fetch_add(1, std::memory_order_relaxed);
+#endif
+	}
+	void resource(bool found, size_t bytes, bool fromCache, Clock::time_point getterStart) {
+#ifndef WEBVIEW_GUI_NO_METRICS
+		resourceRequests.fetch_add(1, std::memory_order_relaxed);
+		if (found) {
+			resourcesFound.fetch_add(1, std::memory_order_relaxed);
+			resourceBytes.fetch_add(bytes, std::memory_order_relaxed);
+			if (fromCache) resourceCacheHits.fetch_add(1, std::memory_order_relaxed);
+		}
+		resourceNanos.fetch_add(nanosSince(getterStart), std::memory_order_relaxed);
+#endif
+	}
+	void roundTripSeconds(double seconds) {
+#ifndef WEBVIEW_GUI_NO_METRICS
+		auto micros = uint64_t(seconds > 0 ? seconds*1e6 : 0);
+		size_t bucket = 0;
+		while (micros >= 2 && bucket + 1 < Histogram::buckets) {
+			micros >>= 1;
+			++bucket;
+		}
+		roundTrip[bucket].fetch_add(1, std::memory_order_relaxed);
+#endif
+	}
+
+private:
+#ifndef WEBVIEW_GUI_NO_METRICS
+	std::atomic<uint64_t> messagesSent{0}, bytesSent{0}, encodeNanos{0};
+	std::atomic<uint64_t> messagesReceived{0}, bytesReceived{0}, decodeNanos{0};
+	std::atomic<uint64_t> heldMessages{0}, heldDropped{0};
+	std::atomic<uint64_t> resourceRequests{0}, resourcesFound{0}, resourceBytes{0}, resourceCacheHits{0}, resourceNanos{0};
+	std::atomic<uint64_t> roundTrip[Histogram::buckets] = {};
+
+	static uint64_t nanosSince(Clock::time_point start) {
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+	}
+	static double seconds(const std::atomic<uint64_t> &nanos) {
+		return double(nanos.load(std::memory_order_relaxed))*1e-9;
+	}
+#endif
+};
+
+} // namespace
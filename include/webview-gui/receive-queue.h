@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace webview_gui {
+
+/* Messages from the page, for a real-time (e.g. audio) thread: a preallocated single-producer/single-consumer ring of frames.
+
+The producer is the UI thread (see `WebviewGui::receiveQueue`, which decodes straight into it).  Neither side ever blocks or allocates, and if the ring is full, the message is dropped and counted.
+
+Each frame is a u32 length and a u32 channel ID (0 for plain messages), then the bytes, padded to 8 bytes.  Frames are never split across the end of the ring, so the consumer always gets contiguous bytes.
+*/
+struct ReceiveQueue {
+	ReceiveQueue(size_t capacityBytes) : capacity((capacityBytes + 7)&~size_t(7)) {
+		buffer.reset(new unsigned char[capacity]);
+	}
+	ReceiveQueue(const ReceiveQueue &other) = delete;
+
+	// Producer: space for a `length`-byte message, or null (counted as dropped) if it doesn't fit.  Fill it, then `commit()`.
+	unsigned char * reserve(uint32_t channel, size_t length) {
+		size_t frameBytes = paddedFrameBytes(length);
+		size_t tail = writePos.load(std::memory_order_relaxed);
+		size_t head = readPos.load(std::memory_order_acquire);
+		size_t offset = tail%capacity, untilEnd = capacity - offset;
+		if (head == tail && untilEnd < frameBytes && frameBytes <= capacity) {
+			// Empty, so skip both positions to the start of the ring rather than dropping a frame which only fits there.  The consumer doesn't write `readPos` unless it's read something, so this is safe while it drains.
+			tail += untilEnd;
+			readPos.store(tail, std::memory_order_relaxed);
+			writePos.store(tail, std::memory_order_release);
+			head = tail;
+			offset = 0;
+			untilEnd = capacity;
+		}
+		size_t needed = frameBytes + (untilEnd < frameBytes ? untilEnd : 0);
+		if (frameBytes > capacity || needed > capacity - (tail - head)) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			droppedBytes.fetch_add(length, std::memory_order_relaxed);
+			return nullptr;
+		}
+		if (untilEnd < frameBytes) {
+			writeU32(offset, wrapMarker);
+			tail += untilEnd;
+			offset = 0;
+		}
+		writeU32(offset, uint32_t(length));
+		writeU32(offset + 4, channel);
+		pendingPos = tail + frameBytes;
+		return buffer.get() + offset + headerBytes;
+	}
+	void commit() {
+		writePos.store(pendingPos, std::memory_order_release);
+	}
+	bool push(uint32_t channel, const unsigned char *bytes, size_t length) {
+		auto *frame = reserve(channel, length);
+		if (!frame) return false;
+		std::memcpy(frame, bytes, length);
+		commit();
+		return true;
+	}
+
+	/* Consumer: wait-free, calling `fn(channel, bytes, length)` for up to `maxMessages` messages (e.g. a per-block budget), and returns how many.
+
+	The bytes are only valid during the call.
+	*/
+	template<class Fn>
+	size_t drain(Fn &&fn, size_t maxMessages=SIZE_MAX) {
+		size_t tail = writePos.load(std::memory_order_acquire);
+		// After `tail`, so it's never behind it - but the producer can skip ahead of an empty queue (see `reserve()`), so it can be in front
+		size_t head = readPos.load(std::memory_order_acquire), start = head;
+		size_t count = 0;
+		while (head < tail && count < maxMessages) {
+			size_t offset = head%capacity;
+			uint32_t length = readU32(offset);
+			if (length == wrapMarker) {
+				head += capacity - offset;
+				continue;
+			}
+			fn(readU32(offset + 4), (const unsigned char *)buffer.get() + offset + headerBytes, size_t(length));
+			head += paddedFrameBytes(length);
+			++count;
+		}
+		if (head != start) readPos.store(head, std::memory_order_release);
+		return count;
+	}
+
+	// Messages which didn't fit, since the queue was created
+	uint64_t droppedCount() const {
+		return dropped.load(std::memory_order_relaxed);
+	}
+	uint64_t droppedByteCount() const {
+		return droppedBytes.load(std::memory_order_relaxed);
+	}
+private:
+	static constexpr size_t headerBytes = 8;
+	static constexpr uint32_t wrapMarker = 0xFFFFFFFF;
+	size_t capacity;
+	std::unique_ptr<unsigned char[]> buffer;
+	// Total bytes written/read (including padding and skipped ends), so full and empty are distinguishable
+	std::atomic<size_t> writePos{0}, readPos{0};
+	size_t pendingPos = 0; // producer-only
+	std::atomic<uint64_t> dropped{0}, droppedBytes{0};
+
+	static size_t paddedFrameBytes(size_t length) {
+		return (headerBytes + length + 7)&~size_t(7);
+	}
+	void writeU32(size_t offset, uint32_t value) {
+		std::memcpy(buffer.get() + offset, &value, 4);
+	}
+	uint32_t readU32(size_t offset) const {
+		uint32_t value;
+		std::memcpy(&value, buffer.get() + offset, 4);
+		return value;
+	}
+};
+
+} // namespace
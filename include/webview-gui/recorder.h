@@ -0,0 +1,201 @@
+#pragma once
+
+#include "./helpers.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace webview_gui {
+
+/* Record-and-replay of message traffic, to reproduce (and benchmark against) a real session.
+
+The file is append-only: an 8-byte magic "WVGUIREC", then records of:
+	u8 type, u64 nanoseconds since recording started, u32 id, u32 length, payload
+with numbers little-endian.  The `id` and payload depend on the type:
+	SEND/RECEIVE: channel ID (0 for plain `send()`/`receive`), message bytes
+	SEND_TEXT/RECEIVE_TEXT: 0, UTF-8 text
+	CHANNEL: channel ID, the channel's name (recorded when the ID is assigned)
+	RESOURCE: response size (or 0xFFFFFFFF if not found), the requested path
+*/
+struct Recorder {
+	enum class Type : uint8_t {
+		SEND = 1, RECEIVE = 2, CHANNEL = 3, RESOURCE = 4, SEND_TEXT = 5, RECEIVE_TEXT = 6
+	};
+	static constexpr const char *magic = "WVGUIREC";
+	static constexpr uint32_t notFound = 0xFFFFFFFF;
+
+	// Writes happen on a background thread, which wakes when `flushBytes` are waiting (or every 100ms)
+	Recorder(const std::string &path, size_t flushBytes=65536) : flushBytes(flushBytes) {
+		file = std::fopen(path.c_str(), "wb");
+		if (!file) return;
+		std::fwrite(magic, 1, 8, file);
+		pending.reserve(flushBytes*2);
+		writing.reserve(flushBytes*2);
+		writerThread = std::thread([this](){writerLoop();});
+	}
+	~Recorder() {
+		if (!file) return;
+		{
+			std::lock_guard<std::mutex> guard{mutex};
+			closing = true;
+		}
+		wake.notify_one();
+		writerThread.join();
+		std::fclose(file);
+	}
+	Recorder(const Recorder &other) = delete;
+
+	bool ok() const {
+		return file;
+	}
+
+	// Only copies into a buffer, so it's safe to call from the UI thread
+	void record(Type type, uint32_t id, const void *payload, size_t length) {
+		if (!file) return;
+		auto nanos = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		bool full;
+		{
+			std::lock_guard<std::mutex> guard{mutex};
+			pending.push_back(char(type));
+			appendLe(nanos, 8);
+			appendLe(id, 4);
+			appendLe(length, 4);
+			pending.insert(pending.end(), (const char *)payload, (const char *)payload + length);
+			full = pending.size() >= flushBytes;
+		}
+		if (full) wake.notify_one();
+	}
+private:
+	std::FILE *file = nullptr;
+	size_t flushBytes;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool closing = false;
+	std::vector<char> pending, writing; // swapped, so the writer doesn't hold the lock while writing
+	std::thread writerThread;
+
+	void appendLe(uint64_t value, int bytes) {
+		for (int i = 0; i < bytes; ++i) pending.push_back(char(value >> (i*8)));
+	}
+
+	void writerLoop() {
+		std::unique_lock<std::mutex> lock{mutex};
+		while (true) {
+			wake.wait_for(lock, std::chrono::milliseconds(100), [this](){
+				return closing || pending.size() >= flushBytes;
+			});
+			std::swap(pending, writing);
+			bool done = closing;
+			lock.unlock();
+			if (!writing.empty()) {
+				std::fwrite(writing.data(), 1, writing.size(), file);
+				std::fflush(file);
+				writing.clear();
+			}
+			if (done) return;
+			lock.lock();
+		}
+	}
+};
+
+// Reads a recording, and plays it back at the original (or a scaled) speed
+struct Replayer {
+	using Type = Recorder::Type;
+	struct Record {
+		Type type;
+		double seconds; // since recording started
+		uint32_t id;
+		std::vector<unsigned char> payload;
+	};
+	std::vector<Record> records;
+
+	// Returns `false` if the file couldn't be read, or isn't a recording - a truncated final record is ignored
+	bool load(const std::string &path) {
+		records.clear();
+		std::FILE *file = std::fopen(path.c_str(), "rb");
+		if (!file) return false;
+		char header[8];
+		bool valid = std::fread(header, 1, 8, file) == 8 && !std::memcmp(header, Recorder::magic, 8);
+		unsigned char fixed[17];
+		while (valid && std::fread(fixed, 1, 17, file) == 17) {
+			Record record;
+			record.type = Type(fixed[0]);
+			record.seconds = double(readLe(fixed + 1, 8))*1e-9;
+			record.id = uint32_t(readLe(fixed + 9, 4));
+			record.payload.resize(size_t(readLe(fixed + 13, 4)));
+			if (std::fread(record.payload.data(), 1, record.payload.size(), file) != record.payload.size()) break;
+			records.push_back(std::move(record));
+		}
+		std::fclose(file);
+		return valid;
+	}
+
+	/* Calls `fn(record)` for each record, sleeping so they're spaced out as they were recorded.
+
+	A `speed` of 2 plays back twice as fast, and 0 (or less) doesn't wait at all.
+	*/
+	template<class Fn>
+	void play(Fn &&fn, double speed=1) const {
+		auto playStart = std::chrono::steady_clock::now();
+		for (auto &record : records) {
+			if (speed > 0) {
+				std::this_thread::sleep_until(playStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(record.seconds/speed)));
+			}
+			fn(record);
+		}
+	}
+
+	/* Drives a `WebviewGui` with the recorded messages: sends are sent again, and received messages are passed in as though they came from the page (through the same decoding/dispatch).
+
+	Channels are matched by name.  Resource requests come from the page, so they're skipped here - use `play()` to handle them yourself (e.g. with the loopback backend's `Page::fetch()`).
+	*/
+	template<class Gui>
+	void replay(Gui &gui, double speed=1) const {
+		std::vector<uint32_t> channelMap;
+		auto mapChannel = [&](uint32_t id){
+			return (id < channelMap.size()) ? channelMap[id] : 0;
+		};
+		std::string base64;
+		play([&](const Record &record){
+			if (record.type == Type::CHANNEL) {
+				if (channelMap.size() <= record.id) channelMap.resize(record.id + 1);
+				channelMap[record.id] = gui.channel(std::string(record.payload.begin(), record.payload.end()));
+			} else if (record.type == Type::SEND) {
+				if (!record.id) {
+					gui.send(record.payload.data(), record.payload.size());
+				} else if (auto id = mapChannel(record.id)) {
+					gui.send(id, record.payload.data(), record.payload.size());
+				}
+			} else if (record.type == Type::RECEIVE) {
+				auto id = mapChannel(record.id);
+				if (record.id && !id) return;
+				base64 = id ? std::to_string(id) + ":" : std::string();
+				helpers::encodeBase64(record.payload.data(), record.payload.size(), base64);
+				gui.receive64(base64.c_str());
+			} else if (record.type == Type::SEND_TEXT) {
+				gui.sendText((const char *)record.payload.data(), record.payload.size());
+			} else if (record.type == Type::RECEIVE_TEXT) {
+				base64 = "'";
+				base64.append((const char *)record.payload.data(), record.payload.size());
+				gui.receive64(base64.c_str());
+			}
+		}, speed);
+	}
+private:
+	static uint64_t readLe(const unsigned char *bytes, int count) {
+		uint64_t value = 0;
+		for (int i = count - 1; i >= 0; --i) value = (value << 8) + bytes[i];
+		return value;
+	}
+};
+
+} // namespace
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "./webview-gui.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace webview_gui {
+
+// Builds a `ResourceGetter` which dispatches paths to handlers, falling through to static sources (e.g. a directory).
+//
+// Routes are matched segment-by-segment through a trie, built once when `getter()` is called:
+//	"/presets/list.json" - exact
+//	"/presets/{id}/thumbnail.png" - `{id}` matches any one segment, available as `request.param("id")`
+//	"/api/*" - "/api" and anything below it, with the remainder in `request.rest`
+// Literal segments win over `{params}`, which win over `*` prefixes.  If a handler returns `false`, the static sources are tried.
+//
+// Parsing a request doesn't allocate: the path, query and parameters are all views into the requested path.
+struct Router {
+	struct Request {
+		std::string_view path; // without the query
+		std::string_view query; // after the '?', not decoded
+		std::string_view rest; // for `*` routes, what came after the prefix (including the leading '/')
+
+		// Values of `{name}` segments, or empty if there isn't one
+		std::string_view param(std::string_view name) const {
+			for (size_t i = 0; i < paramCount; ++i) {
+				if ((*paramNames)[i] == name) return params[i];
+			}
+			return {};
+		}
+		// The raw (not URL-decoded) value of a query parameter, or empty
+		std::string_view queryValue(std::string_view key) const {
+			auto remaining = query;
+			while (!remaining.empty()) {
+				auto end = remaining.find('&');
+				auto pair = remaining.substr(0, end);
+				auto equals = pair.find('=');
+				if (pair.substr(0, equals) == key) {
+					return (equals == std::string_view::npos) ? std::string_view{} : pair.substr(equals + 1);
+				}
+				if (end == std::string_view::npos) break;
+				remaining.remove_prefix(end + 1);
+			}
+			return {};
+		}
+	private:
+		friend struct Router;
+		static constexpr size_t maxParams = 8;
+		std::string_view params[maxParams];
+		size_t paramCount = 0;
+		const std::vector<std::string> *paramNames = nullptr;
+	};
+	using Handler = std::function<bool(const Request &request, WebviewGui::Resource &resource)>;
+
+	Router & route(const std::string &pattern, Handler handler) {
+		routes.push_back({pattern, std::move(handler)});
+		return *this;
+	}
+	// Tried in order, for anything which didn't match a route (or whose handler returned `false`)
+	Router & fallback(WebviewGui::ResourceGetter getter) {
+		fallbacks.push_back(std::move(getter));
+		return *this;
+	}
+	Router & directory(const std::string &baseDir) {
+		return fallback(WebviewGui::fileGetter(baseDir));
+	}
+
+	// The routes are copied into a trie at this point, so later changes to the `Router` don't affect it
+	WebviewGui::ResourceGetter getter() const {
+		auto trie = std::make_shared<Trie>(routes, fallbacks);
+		return [trie](const char *path, WebviewGui::Resource &resource){
+			return trie->get(path, resource);
+		};
+	}
+
+private:
+	struct Route {
+		std::string pattern;
+		Handler handler;
+	};
+	std::vector<Route> routes;
+	std::vector<WebviewGui::ResourceGetter> fallbacks;
+
+	struct Trie {
+		struct Node {
+			std::vector<std::pair<std::string, size_t>> children; // sorted by segment, for binary search
+			size_t paramChild = 0; // 0 means none (the root can't be a child)
+			int exactRoute = -1, prefixRoute = -1;
+		};
+		struct CompiledRoute {
+			Handler handler;
+			std::vector<std::string> paramNames;
+		};
+		std::vector<Node> nodes;
+		std::vector<CompiledRoute> compiled;
+		std::vector<WebviewGui::ResourceGetter> fallbacks;
+
+		Trie(const std::vector<Route> &routes, const std::vector<WebviewGui::ResourceGetter> &fallbacks) : fallbacks(fallbacks) {
+			nodes.emplace_back();
+			for (auto &route : routes) add(route);
+			for (auto &node : nodes) {
+				std::sort(node.children.begin(), node.children.end());
+			}
+		}
+
+		void add(const Route &route) {
+			CompiledRoute compiledRoute{route.handler, {}};
+			size_t node = 0;
+			bool prefix = false;
+			std::string_view remaining = route.pattern;
+			while (!remaining.empty()) {
+				if (remaining[0] == '/') {
+					remaining.remove_prefix(1);
+					continue;
+				}
+				auto segment = remaining.substr(0, remaining.find('/'));
+				remaining.remove_prefix(segment.size());
+				if (segment == "*") {
+					prefix = true;
+					break;
+				}
+				if (segment.size() >= 2 && segment.front() == '{' && segment.back() == '}') {
+					compiledRoute.paramNames.emplace_back(segment.substr(1, segment.size() - 2));
+					if (!nodes[node].paramChild) {
+						nodes[node].paramChild = nodes.size();
+						nodes.emplace_back();
+					}
+					node = nodes[node].paramChild;
+				} else {
+					node = literalChild(node, segment);
+				}
+			}
+			if (compiledRoute.paramNames.size() > Request::maxParams) return;
+			(prefix ? nodes[node].prefixRoute : nodes[node].exactRoute) = int(compiled.size());
+			compiled.push_back(std::move(compiledRoute));
+		}
+		size_t literalChild(size_t node, std::string_view segment) {
+			for (auto &pair : nodes[node].children) {
+				if (pair.first == segment) return pair.second;
+			}
+			size_t child = nodes.size();
+			nodes[node].children.emplace_back(std::string(segment), child);
+			nodes.emplace_back();
+			return child;
+		}
+
+		bool get(const char *pathCStr, WebviewGui::Resource &resource) const {
+			Request request;
+			std::string_view full = pathCStr;
+			auto queryStart = full.find('?');
+			request.path = full.substr(0, queryStart);
+			if (queryStart != std::string_view::npos) request.query = full.substr(queryStart + 1);
+
+			if (match(0, request.path, request, resource)) return true;
+			for (auto &getter : fallbacks) {
+				if (getter(pathCStr, resource)) return true;
+			}
+			return false;
+		}
+
+		// Depth-first, so a literal segment which doesn't lead anywhere falls back to a `{param}`, and then to the closest `*`
+		bool match(size_t nodeIndex, std::string_view remaining, Request &request, WebviewGui::Resource &resource) const {
+			auto &node = nodes[nodeIndex];
+			auto afterNode = remaining;
+			while (!remaining.empty() && remaining[0] == '/') remaining.remove_prefix(1);
+			if (remaining.empty()) {
+				if (node.exactRoute >= 0 && call(node.exactRoute, {}, request, resource)) return true;
+			} else {
+				auto segment = remaining.substr(0, remaining.find('/'));
+				auto next = remaining.substr(segment.size());
+				auto iter = std::lower_bound(node.children.begin(), node.children.end(), segment, [](const std::pair<std::string, size_t> &pair, std::string_view segment){
+					return std::string_view(pair.first) < segment;
+				});
+				if (iter != node.children.end() && iter->first == segment) {
+					if (match(iter->second, next, request, resource)) return true;
+				}
+				if (node.paramChild && request.paramCount < Request::maxParams) {
+					request.params[request.paramCount++] = segment;
+					if (match(node.paramChild, next, request, resource)) return true;
+					--request.paramCount;
+				}
+			}
+			return node.prefixRoute >= 0 && call(node.prefixRoute, afterNode, request, resource);
+		}
+		bool call(int routeIndex, std::string_view rest, Request &request, WebviewGui::Resource &resource) const {
+			auto &route = compiled[size_t(routeIndex)];
+			request.paramNames = &route.paramNames;
+			request.rest = rest;
+			return route.handler(request, resource);
+		}
+	};
+};
+
+} // namespace
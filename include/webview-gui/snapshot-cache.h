@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace webview_gui {
+
+/* PNG snapshots of a rendered GUI, keyed by (ID, width, height), so the next editor can show one immediately while its page loads.
+
+Kept in memory, and also in a directory if one is given (e.g. a per-user cache folder), so they survive restarts.  Methods are thread-safe.  See `WebviewGui::captureSnapshot()`/`showPlaceholder()`.
+*/
+struct SnapshotCache {
+	SnapshotCache(const std::string &directory={}) : directory(directory) {}
+	SnapshotCache(const SnapshotCache &other) = delete;
+
+	// Shared by everything in the process (e.g. all instances of a plugin)
+	static std::shared_ptr<SnapshotCache> shared() {
+		static auto cache = std::make_shared<SnapshotCache>();
+		return cache;
+	}
+
+	// Empty if there's no snapshot for this ID and size
+	std::vector<unsigned char> get(const std::string &id, int width, int height) {
+		std::lock_guard<std::mutex> guard{mutex};
+		auto key = std::make_tuple(id, width, height);
+		auto iter = snapshots.find(key);
+		if (iter != snapshots.end()) return iter->second;
+		auto png = readFile(key);
+		if (!png.empty()) snapshots[key] = png;
+		return png;
+	}
+	// Empty snapshots (from platforms which can't take them) are ignored
+	void put(const std::string &id, int width, int height, std::vector<unsigned char> png) {
+		if (png.empty()) return;
+		std::lock_guard<std::mutex> guard{mutex};
+		auto key = std::make_tuple(id, width, height);
+		writeFile(key, png);
+		snapshots[key] = std::move(png);
+	}
+	void clear() {
+		std::lock_guard<std::mutex> guard{mutex};
+		snapshots.clear();
+	}
+
+private:
+	using Key = std::tuple<std::string, int, int>;
+	std::string directory;
+	std::mutex mutex;
+	std::map<Key, std::vector<unsigned char>> snapshots;
+
+	// "{id}-{width}x{height}.png", with anything but [A-Za-z0-9._-] in the ID replaced
+	std::string filePath(const Key &key) const {
+		std::string name = std::get<0>(key);
+		for (auto &c : name) {
+			bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+			if (!safe) c = '_';
+		}
+		return directory + "/" + name + "-" + std::to_string(std::get<1>(key)) + "x" + std::to_string(std::get<2>(key)) + ".png";
+	}
+	std::vector<unsigned char> readFile(const Key &key) const {
+		std::vector<unsigned char> png;
+		if (directory.empty()) return png;
+		if (auto *file = std::fopen(filePath(key).c_str(), "rb")) {
+			unsigned char buffer[16384];
+			size_t count;
+			while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) png.insert(png.end(), buffer, buffer + count);
+			std::fclose(file);
+		}
+		return png;
+	}
+	void writeFile(const Key &key, const std::vector<unsigned char> &png) const {
+		if (directory.empty()) return;
+		if (auto *file = std::fopen(filePath(key).c_str(), "wb")) {
+			std::fwrite(png.data(), 1, png.size(), file);
+			std::fclose(file);
+		}
+	}
+};
+
+} // namespace
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "./webview-gui.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace webview_gui {
+
+/* A byte buffer owned by C++, mirrored into a persistent `ArrayBuffer` in the page, where only the changed ranges are sent.
+
+Edit `state` (including resizing it), then call `update()` (e.g. once per UI frame).  The buffer is split into fixed-size blocks, each tagged with the version it last changed in, so the page can always be brought up to date from whatever version it has.  Each update sends every block changed since the version the page last acknowledged, so it applies to a page anywhere between that and the previous update (acknowledgements can lag behind).
+
+Messages use a named channel (see `WebviewGui::channel()`), with little-endian numbers:
+	C++ -> page:
+		u32 base version, u32 new version, u32 total size, u32 range count, then (u32 offset, u32 length, bytes) for each range - a page at `base` or later applies it
+	page -> C++:
+		u32 version, u8 kind: 0 = acknowledged, 1 = please resync from this version (e.g. 0 after a reload, or after missing a delta)
+
+`StateMirror::jsSource` implements the page side.
+*/
+struct StateMirror {
+	std::vector<unsigned char> state;
+
+	StateMirror(WebviewGui &gui, const std::string &name="state", size_t blockSize=64) : gui(gui), name(name), blockSize(std::max<size_t>(blockSize, 1)) {
+		channel = gui.channel(name, [this](const unsigned char *bytes, size_t length){
+			receive(bytes, length);
+		});
+	}
+	// The `WebviewGui` can outlive us, so the channel's handler (which points at us) is removed
+	~StateMirror() {
+		gui.channel(name, nullptr);
+	}
+	StateMirror(const StateMirror &other) = delete;
+
+	// Sends anything which changed since the last update, as a single message - returns `false` if nothing changed
+	bool update() {
+		uint32_t newVersion = version + 1;
+		bool changed = (state.size() != shadow.size());
+		size_t blockCount = (state.size() + blockSize - 1)/blockSize;
+		if (state.size() > shadow.size()) {
+			// The page's buffer might have stale bytes past its old size, so anything from there on is sent
+			blockVersions.resize(shadow.size()/blockSize);
+		}
+		blockVersions.resize(blockCount, newVersion);
+		shadow.resize(state.size());
+		for (size_t b = 0; b < blockCount; ++b) {
+			size_t start = b*blockSize, length = std::min(blockSize, state.size() - start);
+			if (std::memcmp(state.data() + start, shadow.data() + start, length)) {
+				std::memcpy(shadow.data() + start, state.data() + start, length);
+				blockVersions[b] = newVersion;
+				changed = true;
+			}
+		}
+		if (!changed) return false;
+		version = newVersion;
+		sendSince(ackedVersion);
+		return true;
+	}
+
+	uint32_t currentVersion() const {
+		return version;
+	}
+	// The latest version the page has confirmed it applied
+	uint32_t pageVersion() const {
+		return ackedVersion;
+	}
+
+	static constexpr const char *jsSource = R"JS(
+	(()=>{
+		// let mirror = new WebviewGuiStateMirror('state');
+		// mirror.addEventListener('change', e => {...mirror.bytes...}); // `e.detail` is a list of {offset, length}
+		class WebviewGuiStateMirror extends EventTarget {
+			buffer = new ArrayBuffer(0);
+			bytes = new Uint8Array(this.buffer); // only the first `size` bytes
+			size = 0;
+			version = 0;
+			#channel;
+			#resyncing = true;
+
+			constructor(name) {
+				super();
+				this.#channel = webviewGui.channel(name);
+				this.#channel.addEventListener('message', e=>this.#apply(new DataView(e.data)));
+				this.#post(1);
+			}
+
+			#post(kind) {
+				let view = new DataView(new ArrayBuffer(5));
+				view.setUint32(0, this.version, true);
+				view.setUint8(4, kind);
+				this.#channel.send(view.buffer);
+			}
+			#apply(view) {
+				let base = view.getUint32(0, true), version = view.getUint32(4, true);
+				// Everything changed since `base` is included, so being further along is fine
+				if (base > this.version) {
+					// We missed something: ask once, and ignore anything else until the resync arrives
+					if (!this.#resyncing) this.#post(1);
+					this.#resyncing = true;
+					return;
+				}
+				this.#resyncing = false;
+				let size = view.getUint32(8, true);
+				if (size > this.buffer.byteLength) {
+					// Grow geometrically, so the buffer is mostly persistent
+					let buffer = new ArrayBuffer(Math.max(size, this.buffer.byteLength*2));
+					new Uint8Array(buffer).set(this.bytes.subarray(0, this.size));
+					this.buffer = buffer;
+				}
+				this.bytes = new Uint8Array(this.buffer, 0, size);
+				this.size = size;
+				let ranges = [], pos = 16;
+				for (let i = view.getUint32(12, true); i > 0; --i) {
+					let offset = view.getUint32(pos, true), length = view.getUint32(pos + 4, true);
+					this.bytes.set(new Uint8Array(view.buffer, view.byteOffset + pos + 8, length), offset);
+					ranges.push({offset: offset, length: length});
+					pos += 8 + length;
+				}
+				this.version = version;
+				this.#post(0);
+				this.dispatchEvent(new CustomEvent('change', {detail: ranges}));
+			}
+		}
+		window.WebviewGuiStateMirror = WebviewGuiStateMirror;
+	})();
+	)JS";
+
+private:
+	WebviewGui &gui;
+	std::string name;
+	uint32_t channel;
+	size_t blockSize;
+
+	uint32_t version = 0, ackedVersion = 0;
+	std::vector<unsigned char> shadow; // the state as of `version`
+	std::vector<uint32_t> blockVersions;
+	std::vector<unsigned char> message;
+
+	// Sends every block which changed after `base`, as one message taking the page from `base` to `version`
+	void sendSince(uint32_t base) {
+		message.clear();
+		writeU32(base);
+		writeU32(version);
+		writeU32(uint32_t(shadow.size()));
+		writeU32(0);
+		uint32_t rangeCount = 0;
+		size_t b = 0;
+		while (b < blockVersions.size()) {
+			if (blockVersions[b] <= base) {
+				++b;
+				continue;
+			}
+			// Adjacent changed blocks are merged into one range
+			size_t end = b + 1;
+			while (end < blockVersions.size() && blockVersions[end] > base) ++end;
+			size_t start = b*blockSize, length = std::min(end*blockSize, shadow.size()) - start;
+			writeU32(uint32_t(start));
+			writeU32(uint32_t(length));
+			message.insert(message.end(), shadow.begin() + start, shadow.begin() + start + length);
+			++rangeCount;
+			b = end;
+		}
+		for (int i = 0; i < 4; ++i) message[12 + i] = (unsigned char)(rangeCount >> (i*8));
+		gui.send(channel, message.data(), message.size());
+	}
+
+	void receive(const unsigned char *bytes, size_t length) {
+		if (length < 5) return;
+		uint32_t fromVersion = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+		if (bytes[4] == 0) {
+			ackedVersion = std::max(ackedVersion, fromVersion);
+		} else {
+			// A page from before we existed (or a stale one) starts from scratch
+			if (fromVersion > version) fromVersion = 0;
+			ackedVersion = fromVersion;
+			sendSince(fromVersion);
+		}
+	}
+
+	void writeU32(uint32_t v) {
+		for (int i = 0; i < 4; ++i) message.push_back((unsigned char)(v >> (i*8)));
+	}
+};
+
+} // namespace
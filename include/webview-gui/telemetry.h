@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace webview_gui {
+
+/* Latest-frame telemetry (meters, scopes, spectra), pulled by the page instead of pushed.
+
+The producer publishes frames into a triple buffer from any thread (including audio), without blocking or allocating.  The page fetches the latest frame as a raw `ArrayBuffer` from a reserved resource path, once per animation frame:
+	webviewGui.telemetry('meters', buffer => {...});
+so the cost is bounded by the display rate, not the publish rate.  See `WebviewGui::serveTelemetry()`.
+*/
+struct Telemetry {
+	Telemetry(size_t maxFrameBytes) : maxFrameBytes(maxFrameBytes) {
+		for (auto &frame : frames) frame.bytes.reset(new unsigned char[maxFrameBytes]);
+	}
+	Telemetry(const Telemetry &other) = delete;
+
+	// Producer (one thread at a time): wait-free, and frames longer than `maxFrameBytes` are truncated
+	void publish(const void *data, size_t length) {
+		auto &frame = frames[back];
+		frame.length = std::min(length, maxFrameBytes);
+		std::memcpy(frame.bytes.get(), data, frame.length);
+		// Swap our buffer with the middle one, marking it as fresh
+		auto previous = middle.exchange(uint8_t(back | freshBit), std::memory_order_acq_rel);
+		back = previous & indexMask;
+		published.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Consumer (one thread at a time): copies the latest frame, returning `false` if nothing has been published yet
+	bool latest(std::vector<unsigned char> &bytes) {
+		if (middle.load(std::memory_order_relaxed) & freshBit) {
+			auto previous = middle.exchange(front, std::memory_order_acq_rel);
+			front = previous & indexMask;
+			haveFrame = true;
+		}
+		if (!haveFrame) return false;
+		auto &frame = frames[front];
+		bytes.assign(frame.bytes.get(), frame.bytes.get() + frame.length);
+		return true;
+	}
+
+	// Frames published so far (including ones the page never saw)
+	uint64_t publishedCount() const {
+		return published.load(std::memory_order_relaxed);
+	}
+private:
+	static constexpr uint8_t indexMask = 3, freshBit = 4;
+	size_t maxFrameBytes;
+	struct Frame {
+		std::unique_ptr<unsigned char[]> bytes;
+		size_t length = 0;
+	};
+	Frame frames[3];
+	uint8_t back = 0, front = 1; // each owned by one side
+	bool haveFrame = false;
+	std::atomic<uint8_t> middle{2};
+	std::atomic<uint64_t> published{0};
+};
+
+} // namespace
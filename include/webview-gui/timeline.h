@@ -0,0 +1,138 @@
+#pragma once
+
+#include "./helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace webview_gui {
+
+// Timestamped milestones, to see where the time goes while a webview opens
+struct Timeline {
+	using Clock = std::chrono::steady_clock;
+
+	struct Event {
+		std::string name;
+		std::string detail; // e.g. the path for "resource" events
+		Clock::time_point start;
+		Clock::duration duration{0}; // zero for instantaneous milestones
+	};
+
+	// Events beyond this are dropped (and counted), so a long session's resource requests don't grow the list forever - startup comes first, so it's kept
+	size_t maxEvents = 1024;
+
+	void mark(const std::string &name, const std::string &detail={}) {
+		add(name, Clock::now(), Clock::duration{0}, detail);
+	}
+	// Only records the first occurrence (e.g. "first-receive")
+	void markOnce(const std::string &name, const std::string &detail={}) {
+		std::lock_guard<std::mutex> guard{mutex};
+		for (auto &e : eventList) {
+			if (e.name == name) return;
+		}
+		push({name, detail, Clock::now(), Clock::duration{0}});
+	}
+	void add(const std::string &name, Clock::time_point start, Clock::duration duration, const std::string &detail={}) {
+		std::lock_guard<std::mutex> guard{mutex};
+		push({name, detail, start, duration});
+	}
+	void add(const Event &event) {
+		std::lock_guard<std::mutex> guard{mutex};
+		push(Event{event});
+	}
+	// How many events were dropped because of `maxEvents`
+	size_t dropped() const {
+		std::lock_guard<std::mutex> guard{mutex};
+		return droppedCount;
+	}
+
+	// A copy of the events so far, in the order they were recorded
+	std::vector<Event> events() const {
+		std::lock_guard<std::mutex> guard{mutex};
+		return eventList;
+	}
+	// Time from the first recorded event until the named one (or negative if it hasn't happened yet)
+	double secondsUntil(const std::string &name) const {
+		std::lock_guard<std::mutex> guard{mutex};
+		if (eventList.empty()) return -1;
+		auto origin = eventList[0].start;
+		for (auto &e : eventList) origin = std::min(origin, e.start);
+		for (auto &e : eventList) {
+			if (e.name == name) return std::chrono::duration<double>(e.start + e.duration - origin).count();
+		}
+		return -1;
+	}
+
+	// Chrome's trace-event JSON format, which can be loaded in `chrome://tracing` or Perfetto
+	std::string toChromeTrace(int pid=1) const {
+		auto list = events();
+		std::string json = "{\"traceEvents\":[";
+		if (!list.empty()) {
+			auto origin = list[0].start;
+			for (auto &e : list) origin = std::min(origin, e.start);
+			auto micros = [](Clock::duration d){
+				return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+			};
+			bool first = true;
+			for (auto &e : list) {
+				if (!first) json += ",";
+				first = false;
+				json += "{\"name\":";
+				helpers::appendJsonString(json, e.name.data(), e.name.size());
+				json += ",\"cat\":\"webview-gui\",\"pid\":" + std::to_string(pid) + ",\"tid\":1,\"ts\":" + micros(e.start - origin);
+				if (e.duration.count() > 0) {
+					json += ",\"ph\":\"X\",\"dur\":" + micros(e.duration);
+				} else {
+					json += ",\"ph\":\"i\",\"s\":\"p\"";
+				}
+				if (!e.detail.empty()) {
+					json += ",\"args\":{\"detail\":";
+					helpers::appendJsonString(json, e.detail.data(), e.detail.size());
+					json += "}";
+				}
+				json += "}";
+			}
+		}
+		json += "]}";
+		return json;
+	}
+private:
+	mutable std::mutex mutex;
+	std::vector<Event> eventList;
+	size_t droppedCount = 0;
+
+	// With `mutex` held
+	void push(Event &&event) {
+		if (eventList.size() >= maxEvents) {
+			++droppedCount;
+		} else {
+			eventList.push_back(std::move(event));
+		}
+	}
+};
+
+// Milestones from before there's a `Timeline` to put them in (e.g. a platform's setup, before its `WebviewGui` exists), passed on by `attach()`
+struct PendingTimeline {
+	// Timed from `start` until now
+	void add(const std::string &name, Timeline::Clock::time_point start, const std::string &detail={}) {
+		Timeline::Event event{name, detail, start, Timeline::Clock::now() - start};
+		if (target) {
+			target->add(event);
+		} else {
+			pending.push_back(std::move(event));
+		}
+	}
+	void attach(Timeline &timeline) {
+		target = &timeline;
+		for (auto &event : pending) timeline.add(event);
+		pending.clear();
+	}
+private:
+	Timeline *target = nullptr;
+	std::vector<Timeline::Event> pending;
+};
+
+} // namespace
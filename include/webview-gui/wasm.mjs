@@ -0,0 +1,198 @@
+/* JS side of the WebAssembly backend (see `_impl/platform/wasm.h`), for wasm32 modules: pointers and sizes are plain numbers, not BigInts.
+
+In the module's JS:
+	let glue = webviewGuiWasm({open: (startPath, fetch)=>port});
+	let {instance} = await WebAssembly.instantiate(bytes, {...imports, ...glue.imports});
+	glue.connect(instance);
+
+`open()` returns where the page is: anything with `postMessage(message, transfer)` and `addEventListener('message', ...)`, like a `MessagePort` or `Worker`.  By default it's the parent frame.  `fetch(path)` gets resources from the C++ `ResourceGetter`, as `{mediaType, bytes}` or `null`.
+
+Plain binary messages are `ArrayBuffer`s (transferred), and text is a string, both ways - so a page can just use `postMessage()`.  Everything else is an object with a `webviewGui` field, which `webviewGuiPage()` (below) handles for the page.
+*/
+export function webviewGuiWasm(options) {
+	options = options || {};
+	let exports = null, memory = null;
+	let guis = [null]; // indexed by handle
+	let encoder = new TextEncoder(), decoder = new TextDecoder();
+	let string = (pointer, length)=>decoder.decode(new Uint8Array(memory.buffer, pointer, length).slice());
+	// Linear memory can't be transferred (and might be shared), so this is the one copy
+	let copyOut = (pointer, length)=>{
+		let buffer = new ArrayBuffer(length);
+		new Uint8Array(buffer).set(new Uint8Array(memory.buffer, pointer, length));
+		return buffer;
+	};
+	let asBytes = data=>{
+		if (data instanceof ArrayBuffer) return new Uint8Array(data);
+		if (ArrayBuffer.isView(data)) return new Uint8Array(data.buffer, data.byteOffset, data.byteLength);
+		return null;
+	};
+	let parentPort = ()=>({
+		postMessage: (message, transfer)=>globalThis.parent.postMessage(message, '*', transfer),
+		addEventListener: (type, listener)=>globalThis.addEventListener(type, listener),
+		removeEventListener: (type, listener)=>globalThis.removeEventListener(type, listener)
+	});
+
+	// Straight into the reusable receive region - kinds match `_wasm::ReceiveKind`
+	let deliver = (gui, kind, channel, bytes)=>{
+		let pointer = exports.webview_gui_receive_buffer(gui.impl, bytes.length);
+		new Uint8Array(memory.buffer, pointer, bytes.length).set(bytes);
+		exports.webview_gui_receive(gui.impl, kind, channel, bytes.length);
+	};
+	let receive = (gui, data)=>{
+		let bytes = asBytes(data);
+		if (bytes) return deliver(gui, 0, 0, bytes);
+		if (typeof data == 'string') return deliver(gui, 1, 0, encoder.encode(data));
+		if (!data || typeof data != 'object') return;
+		if (data.webviewGui == 'message' && (bytes = asBytes(data.data))) {
+			deliver(gui, 0, data.id >>> 0, bytes);
+		} else if (data.webviewGui == 'channel') {
+			deliver(gui, 2, 0, encoder.encode(String(data.name)));
+		} else if (data.webviewGui == 'memory-pressure') {
+			deliver(gui, 3, 0, new Uint8Array(0));
+		} else if (data.webviewGui == 'memory-pressure-done') {
+			deliver(gui, 4, 0, new Uint8Array(0));
+		}
+	};
+	let fetchResource = (gui, path)=>{
+		let bytes = encoder.encode(path);
+		let pointer = exports.webview_gui_receive_buffer(gui.impl, bytes.length);
+		new Uint8Array(memory.buffer, pointer, bytes.length).set(bytes);
+		let descriptor = exports.webview_gui_fetch(gui.impl, bytes.length);
+		if (!descriptor) return null;
+		let [bytesPointer, length, typePointer, typeLength] = new Uint32Array(memory.buffer, descriptor, 4);
+		return {mediaType: string(typePointer, typeLength), bytes: new Uint8Array(copyOut(bytesPointer, length))};
+	};
+
+	let post = (handle, message, transfer)=>{
+		let gui = guis[handle];
+		if (gui) gui.port.postMessage(message, transfer || []);
+	};
+	let imports = {
+		create(impl, pathPointer, pathLength) {
+			let gui = {impl: impl};
+			let handle = guis.push(gui) - 1;
+			gui.port = (options.open || parentPort)(string(pathPointer, pathLength), path=>fetchResource(gui, path));
+			gui.listener = e=>receive(gui, e.data);
+			gui.port.addEventListener('message', gui.listener);
+			if (gui.port.start) gui.port.start();
+			return handle;
+		},
+		destroy(handle) {
+			let gui = guis[handle];
+			if (!gui) return;
+			gui.port.removeEventListener('message', gui.listener);
+			if (options.close) options.close(gui.port);
+			guis[handle] = null;
+		},
+		send(handle, channel, pointer, length) {
+			let buffer = copyOut(pointer, length);
+			post(handle, channel ? {webviewGui: 'message', id: channel, data: buffer} : buffer, [buffer]);
+		},
+		sendText(handle, pointer, length) {
+			post(handle, string(pointer, length));
+		},
+		announceChannel(handle, namePointer, nameLength, channel) {
+			post(handle, {webviewGui: 'channel', name: string(namePointer, nameLength), id: channel});
+		},
+		setVisible(handle, visible, memoryPressureSeconds) {
+			post(handle, {webviewGui: 'visibility', visible: !!visible, memoryPressureSeconds: memoryPressureSeconds});
+		},
+		setSize(handle, width, height) {
+			post(handle, {webviewGui: 'resize', width: width, height: height});
+		},
+		memoryPressure(handle) {
+			post(handle, {webviewGui: 'memory-pressure'});
+		}
+	};
+	return {
+		imports: {'webview-gui': imports},
+		connect(instance) {
+			exports = instance.exports;
+			memory = options.memory || exports.memory;
+		}
+	};
+}
+
+/* The page's side, given where the module is (by default the parent frame):
+	let gui = webviewGuiPage();
+	gui.addEventListener('message', e=>{...}); // `e.data` is an `ArrayBuffer` or string
+	gui.send(bytes);
+	let meters = gui.channel('meters'); // like `webviewGui.channel()` in native pages
+It also dispatches `webview-gui-visibility`, `webview-gui-resize` and `webview-gui-memory-pressure` events, like the native runtime does on `window`.  Memory pressure is acknowledged once the event's listeners have returned, which is when the C++ `memoryPressure()` callback runs.
+*/
+export function webviewGuiPage(port) {
+	port = port || {
+		postMessage: (message, transfer)=>globalThis.parent.postMessage(message, '*', transfer),
+		addEventListener: (type, listener)=>globalThis.addEventListener(type, listener)
+	};
+	let toBuffer = data=>{
+		if (data instanceof ArrayBuffer) return data;
+		let view = new Uint8Array(data.buffer, data.byteOffset, data.byteLength);
+		return view.slice().buffer;
+	};
+	class Channel extends EventTarget {
+		constructor(name) {
+			super();
+			this.name = name;
+			this.id = 0;
+			this.queue = [];
+		}
+		// Transfers `ArrayBuffer`s, so don't use them afterwards
+		send(data) {
+			let buffer = toBuffer(data);
+			if (this.id) {
+				port.postMessage({webviewGui: 'message', id: this.id, data: buffer}, [buffer]);
+			} else {
+				this.queue.push(buffer);
+			}
+		}
+	}
+	let byName = {}, byId = [];
+	let pressureTimer = null;
+	let page = new EventTarget();
+	page.send = data=>{
+		let buffer = toBuffer(data);
+		port.postMessage(buffer, [buffer]);
+	};
+	page.sendText = text=>port.postMessage(String(text));
+	page.channel = name=>{
+		name = String(name);
+		if (!byName[name]) {
+			byName[name] = new Channel(name);
+			port.postMessage({webviewGui: 'channel', name: name});
+		}
+		return byName[name];
+	};
+	port.addEventListener('message', e=>{
+		let data = e.data;
+		if (typeof data == 'string' || data instanceof ArrayBuffer) {
+			page.dispatchEvent(new MessageEvent('message', {data: data}));
+		} else if (!data || typeof data != 'object') {
+			return;
+		} else if (data.webviewGui == 'message') {
+			let channel = byId[data.id];
+			if (channel) channel.dispatchEvent(new MessageEvent('message', {data: data.data}));
+		} else if (data.webviewGui == 'channel') {
+			let channel = byName[data.name] = byName[data.name] || new Channel(data.name);
+			channel.id = data.id;
+			byId[data.id] = channel;
+			channel.queue.forEach(buffer=>channel.send(buffer));
+			channel.queue = [];
+		} else if (data.webviewGui == 'visibility') {
+			clearTimeout(pressureTimer);
+			// Once hidden for long enough, ask C++ to call `WebviewGui::memoryPressure()`
+			if (!data.visible && data.memoryPressureSeconds >= 0) {
+				pressureTimer = setTimeout(()=>port.postMessage({webviewGui: 'memory-pressure'}), data.memoryPressureSeconds*1000);
+			}
+			page.dispatchEvent(new CustomEvent('webview-gui-visibility', {detail: {visible: data.visible}}));
+		} else if (data.webviewGui == 'resize') {
+			page.dispatchEvent(new CustomEvent('webview-gui-resize', {detail: {width: data.width, height: data.height}}));
+		} else if (data.webviewGui == 'memory-pressure') {
+			page.dispatchEvent(new Event('webview-gui-memory-pressure'));
+			// Listeners have run, so C++ can report the memory pressure as done
+			port.postMessage({webviewGui: 'memory-pressure-done'});
+		}
+	});
+	if (port.start) port.start();
+	return page;
+}
@@ -1,9 +1,17 @@
 #pragma once
 
+#include "./timeline.h"
+#include "./metrics.h"
+#include "./recorder.h"
+#include "./telemetry.h"
+#include "./receive-queue.h"
+
+#include <deque>
 #include <functional>
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 namespace webview_gui {
 
@@ -13,6 +21,9 @@ namespace webview_gui {
 #	define WEBVIEW_GUI_IMPL
 #endif
 
+template<class Handler, class Framing>
+struct BasicWebviewGui;
+
 struct WebviewGui {
 	enum class Platform {
 		NONE, HWND, COCOA, X11EMBED
@@ -25,14 +36,27 @@ struct WebviewGui {
 	struct Resource {
 		std::string mediaType;
 		std::vector<unsigned char> bytes;
+		bool fromCache = false; // set by the getter, only for `metrics`
 	};
 	using ResourceGetter = std::function<bool(const char *path, Resource &resource)>;
 	
+	/* Per-webview settings, for `create()`.
+
+	`dataDirectory` asks for a persistent website data store (HTTP/disk cache, storage, etc.) of its own, kept across sessions, so a second launch can reuse what the first one stored - e.g. `defaultDataDirectory(pluginId)`.  Empty means WebKit's default store.  On macOS 14+ each directory gets its own persistent store (WebKit decides where it lives, so the directory only identifies it), and before that the app's default (also persistent) store is used.  This is macOS-only: the CHOC backends ignore it, since CHOC creates the view with its own data store - on Linux that's WebKit's default context, which is already persistent, under `$XDG_CACHE_HOME` and `$XDG_DATA_HOME` (in a subdirectory named after the host program).
+	*/
+	struct Options {
+		std::string dataDirectory;
+	};
+	// A per-user cache location for `Options::dataDirectory`, e.g. "~/.cache/webview-gui/{id}" on Linux, "~/Library/Caches/webview-gui/{id}" on macOS or "%LOCALAPPDATA%\webview-gui\{id}" on Windows, with anything but [A-Za-z0-9._-] in the ID replaced.  It isn't created, and is empty if there's no home directory.
+	WEBVIEW_GUI_IMPL static std::string defaultDataDirectory(const std::string &id);
+
 	WEBVIEW_GUI_IMPL static bool supports(Platform p);
-	WEBVIEW_GUI_IMPL static WebviewGui * create(Platform platform, const std::string &startUrl);
+	WEBVIEW_GUI_IMPL static WebviewGui * create(Platform platform, const std::string &startUrl, const Options &options={});
 	// The starting URL may be relative for these:
-	WEBVIEW_GUI_IMPL static WebviewGui * create(Platform platform, const std::string &startUrl, const std::string &baseDir);
-	WEBVIEW_GUI_IMPL static WebviewGui * create(Platform platform, const std::string &startUrl, ResourceGetter getter);
+	WEBVIEW_GUI_IMPL static WebviewGui * create(Platform platform, const std::string &startUrl, const std::string &baseDir, const Options &options={});
+	WEBVIEW_GUI_IMPL static WebviewGui * create(Platform platform, const std::string &startUrl, ResourceGetter getter, const Options &options={});
+	// Reads resources from files under `baseDir`, as the `baseDir` version of `create()` does
+	WEBVIEW_GUI_IMPL static ResourceGetter fileGetter(const std::string &baseDir);
 	WEBVIEW_GUI_IMPL ~WebviewGui();
 	
 	// Convenience template for creating shared/unique pointers
@@ -51,13 +75,158 @@ struct WebviewGui {
 
 	// Assign this to receive messages
 	std::function<void(const unsigned char *, size_t)> receive;
+	// If set, binary messages with nowhere else to go (plain messages with no `receive`, or channels without a handler) are decoded straight into it, for a real-time thread to drain - see `receive-queue.h`
+	std::shared_ptr<ReceiveQueue> receiveQueue;
 	WEBVIEW_GUI_IMPL void send(const unsigned char *, size_t);
+	// Like `send()`, but messages are state for the given key: while held, only the latest one for each key is kept
+	WEBVIEW_GUI_IMPL void sendState(const std::string &key, const unsigned char *, size_t);
+
+	/* Text (e.g. JSON) without base64: the page gets a `message` event whose `data` is a string, and strings the page posts (`window.parent.postMessage(string, '*')`) arrive here.
+	Text must be valid UTF-8.  If `receiveText` isn't set, incoming text goes to `receive` as UTF-8 bytes.
+	*/
+	std::function<void(const char *, size_t)> receiveText;
+	WEBVIEW_GUI_IMPL void sendText(const char *, size_t);
+	void sendText(const std::string &text) {
+		sendText(text.data(), text.size());
+	}
 	
 	WEBVIEW_GUI_IMPL void setSize(double width, double height);
+	// Hiding the native view also suspends/throttles the page's rendering and timers, and the page gets a `webview-gui-visibility` event
 	WEBVIEW_GUI_IMPL void setVisible(bool visible);
+	// If set, messages sent while hidden are held, and replayed (in order) when shown again
+	bool holdWhileHidden = false;
+	// Beyond this many held messages, the oldest one not from `sendState()` is dropped (and counted in `metrics`), so a stream sent while hidden doesn't grow without bound - 0 for no limit
+	size_t maxHeldMessages = 1024;
+
+	/* Asks the platform and the page to release memory: WebKit's in-memory caches are cleared (macOS and Linux), and the page gets a `webview-gui-memory-pressure` event, so it can drop anything it can rebuild.
+
+	Once WebKit has finished clearing, `callback` (if any) gets a report on the UI thread, which is also kept in `lastMemoryReport`.  On Linux, this has resident memory (this process plus its WebKit descendants) before and after - elsewhere, both are 0.  The callback isn't called if this `WebviewGui` is destroyed first.
+	*/
+	struct MemoryReport {
+		size_t rssBefore = 0, rssAfter = 0;
+	};
+	WEBVIEW_GUI_IMPL void memoryPressure(std::function<void(MemoryReport)> callback={});
+	/* Snapshots, to show straight away while the page loads next time (otherwise the view is blank until the page is ready).  See `SnapshotCache` for keeping them per plugin and size.
+
+	`captureSnapshot()` calls back on the UI thread (possibly later) with PNG bytes of what's currently rendered, or nothing where the platform can't (currently only macOS and Linux can).  `showPlaceholder()` shows a PNG above the page, until the page's first paint.
+	*/
+	WEBVIEW_GUI_IMPL void captureSnapshot(std::function<void(std::vector<unsigned char> png)> callback);
+	WEBVIEW_GUI_IMPL void showPlaceholder(const std::vector<unsigned char> &png);
+
+	// `memoryPressure()` is called automatically once hidden for this many seconds (approximately, since hidden pages' timers are throttled), or never if negative.  Applies from the next `setVisible(false)`.
+	double memoryPressureAfterHidden = 60;
+	// From the most recently completed `memoryPressure()`, including automatic ones
+	MemoryReport lastMemoryReport;
+
+	/* Named channels, each with its own handler instead of `receive`.  In the page:
+		let meters = webviewGui.channel('meters');
+		meters.addEventListener('message', e => {...}); // `e.data` is an `ArrayBuffer`
+		meters.send(bytes);
+	IDs are assigned here, and each name is only sent once (when the page asks for its ID), so routing is an array index on both sides.
+	*/
+	WEBVIEW_GUI_IMPL uint32_t channel(const std::string &name);
+	WEBVIEW_GUI_IMPL uint32_t channel(const std::string &name, std::function<void(const unsigned char *, size_t)> handler);
+	// Channel 0 is the same as plain `send()`
+	WEBVIEW_GUI_IMPL void send(uint32_t channel, const unsigned char *, size_t);
+
+	/* Driving the platform's event loop from someone else's (e.g. a plugin host's), where the platform needs one (currently GTK on Linux).
+	
+	`getEventFds()` lists the file descriptors to watch, and returns a timeout in ms (or -1 for none) after which `processEvents()` should be called anyway.  Call `processEvents()` when any of the FDs are ready, or the timeout expires, and then re-query the FDs.
+	*/
+	struct EventFd {
+		int fd;
+		bool read, write, error;
+	};
+	WEBVIEW_GUI_IMPL static int getEventFds(std::vector<EventFd> &fds);
+	WEBVIEW_GUI_IMPL static void processEvents();
+
+	// Startup milestones: "impl-construct", "webview-create", "navigation-start", "resource" (per request, timing the getter), "dom-content-loaded", "first-receive" and (where the platform reports it) "first-paint"
+	Timeline timeline;
+	// Message/byte counts, encode/decode and resource timing - see `metrics.h`
+	Metrics metrics;
+	// Sends a timestamp which the page echoes straight back, for `metrics.snapshot().roundTrip`
+	WEBVIEW_GUI_IMPL void probeLatency();
+	// If set, all messages (and resource requests) are logged to it - see `recorder.h`
+	std::shared_ptr<Recorder> recorder;
+
+	// Serves the latest frame at the reserved path "/_webview-gui/telemetry/{name}" (so `name` should be URL-safe), which `webviewGui.telemetry(name, callback)` polls once per animation frame.  Needs a resource getter (i.e. not an absolute start URL).
+	WEBVIEW_GUI_IMPL void serveTelemetry(const std::string &name, std::shared_ptr<Telemetry> telemetry);
+
+	// Transient buffers (e.g. the script built for each message) come from a per-instance arena, which is reset after each send, so steady traffic doesn't allocate.  This sets where the arena's blocks come from (e.g. your own pool) - not from inside a handler.
+	void setScratchUpstream(helpers::ArenaUpstream upstream) {
+		scratch.setUpstream(upstream);
+	}
 private:
+	friend struct Replayer;
+	template<class Handler, class Framing>
+	friend struct BasicWebviewGui;
 	struct Impl;
 	Impl *impl;
+
+	bool visible = true;
+	struct HeldMessage {
+		uint32_t channel;
+		std::string key; // empty for plain `send()`
+		std::vector<unsigned char> bytes;
+		bool text = false;
+	};
+	std::deque<HeldMessage> held;
+	WEBVIEW_GUI_IMPL void hold(HeldMessage &&message);
+
+	struct Channel {
+		std::string name;
+		std::function<void(const unsigned char *, size_t)> handler;
+		bool announced = false; // whether the page knows the ID
+		// A handler replaced from inside itself is swapped in once it returns
+		int running = 0;
+		bool replaced = false;
+		std::function<void(const unsigned char *, size_t)> replacement;
+	};
+	// Indexed by ID - 1, and a deque so handlers can add channels without moving the one which is running
+	std::deque<Channel> channels;
+	WEBVIEW_GUI_IMPL void callChannel(Channel &entry, const unsigned char *, size_t);
+	// Reused for decoding, unless a handler sends something which is received synchronously (e.g. the loopback backend)
+	std::vector<unsigned char> receiveBuffer;
+	bool receiving = false;
+	// Set by `BasicWebviewGui`, which decodes and delivers plain (channel 0) messages itself, with its handler inlined
+	struct PlainReceiver {
+		void *context = nullptr;
+		void (*base64)(void *context, const char *base64) = nullptr;
+		void (*binary)(void *context, const unsigned char *bytes, size_t length) = nullptr;
+	} plainReceiver;
+
+	helpers::Arena scratch;
+	int scratchDepth = 0;
+	// Resets `scratch` once the outermost send has finished (the loopback backend can send again from inside one)
+	struct ScratchScope {
+		WebviewGui &gui;
+		ScratchScope(WebviewGui &gui) : gui(gui) {
+			++gui.scratchDepth;
+		}
+		~ScratchScope() {
+			if (!--gui.scratchDepth) gui.scratch.reset();
+		}
+	};
+
+	// Checked before `timeline.markOnce()`, so the receive path doesn't lock and scan the timeline for every message
+	bool firstReceived = false;
+	void markFirstReceive() {
+		if (firstReceived) return;
+		firstReceived = true;
+		timeline.markOnce("first-receive");
+	}
+
+	uint32_t probeChannel = 0;
+	std::vector<std::pair<std::string, std::shared_ptr<Telemetry>>> telemetryStreams;
+	// Fills the resource and returns `true` for telemetry paths (which skip the getter, timeline and recorder)
+	WEBVIEW_GUI_IMPL bool telemetryResource(const char *path, Resource &resource);
+	WEBVIEW_GUI_IMPL void sendToImpl(uint32_t channel, const unsigned char *, size_t);
+	// Everything from the page arrives here: "{base64}", "{id}:{base64}" for a channel, "'{text}" for text, "?{name}" to ask for a channel's ID, or "!memory-pressure" once hidden for `memoryPressureAfterHidden`
+	WEBVIEW_GUI_IMPL void receive64(const char *);
+	// For platforms which get binary messages as bytes (wasm), skipping base64 entirely
+	WEBVIEW_GUI_IMPL void receiveBinary(uint32_t channel, const unsigned char *, size_t);
+	// Platforms report each resource request here (after the getter returns)
+	WEBVIEW_GUI_IMPL void resourceRequested(const char *path, bool found, const Resource &resource, Timeline::Clock::time_point getterStart);
 	// Can only be created using the static methods
 	WEBVIEW_GUI_IMPL WebviewGui(Impl *);
 	WebviewGui(const WebviewGui &other) = delete;